@@ -0,0 +1,270 @@
+#include "analysiscache.h"
+
+#include <QJsonArray>
+#include <QtEndian>
+#include <QDebug>
+#include <cstring>
+#include <cmath>
+
+namespace {
+const char kMagic[4] = { 'G', 'O', 'A', 'C' };
+const quint32 kVersion = 2; // 2: 键中加入棋盘大小
+const int kFileHeaderSize = 8;
+// key(8) scoreLead(4) winrate(4) visits(4) boardSize(1) bestMove(3)
+const int kRecordHeaderSize = 24;
+
+quint64 mix64(quint64 z)
+{
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+quint32 floatBits(float f)
+{
+    quint32 u;
+    std::memcpy(&u, &f, sizeof(u));
+    return u;
+}
+
+float bitsFloat(quint32 u)
+{
+    float f;
+    std::memcpy(&f, &u, sizeof(f));
+    return f;
+}
+}
+
+AnalysisCache::AnalysisCache(int memoryEntries)
+    : m_memory(qMax(1, memoryEntries))
+{
+}
+
+AnalysisCache::~AnalysisCache()
+{
+    close();
+}
+
+quint64 AnalysisCache::makeKey(quint64 positionHash, int boardSize, double komi, const QString &rules, int maxVisits)
+{
+    // 局面哈希与棋盘大小无关 (不同路数的空棋盘哈希均为 0), 必须单独混入
+    quint64 k = positionHash;
+    k ^= mix64(quint64(boardSize) + 0x40000000000000ULL);
+    k ^= mix64(quint64(qint64(std::lround(komi * 2.0))) + 0x100);
+    k ^= mix64(qHash(rules) + 0x200000000ULL);
+    k ^= mix64(quint64(maxVisits) + 0x300000000000ULL);
+    return k;
+}
+
+bool AnalysisCache::open(const QString &path)
+{
+    close();
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadWrite)) {
+        qDebug() << "[AnalysisCache] 无法打开缓存文件:" << path << m_file.errorString();
+        return false;
+    }
+
+    // 新文件或格式不符: 重写文件头
+    char header[kFileHeaderSize];
+    bool valid = m_file.size() >= kFileHeaderSize
+              && m_file.read(header, kFileHeaderSize) == kFileHeaderSize
+              && std::memcmp(header, kMagic, 4) == 0
+              && qFromLittleEndian<quint32>(reinterpret_cast<const uchar *>(header) + 4) == kVersion;
+    if (!valid) {
+        m_file.resize(0);
+        std::memcpy(header, kMagic, 4);
+        qToLittleEndian<quint32>(kVersion, reinterpret_cast<uchar *>(header) + 4);
+        m_file.seek(0);
+        m_file.write(header, kFileHeaderSize);
+        m_file.flush();
+    }
+
+    buildIndex();
+    qDebug() << "[AnalysisCache] 已加载磁盘缓存:" << path << "记录数:" << m_index.size();
+    return true;
+}
+
+void AnalysisCache::close()
+{
+    if (m_map) {
+        m_file.unmap(m_map);
+        m_map = nullptr;
+    }
+    m_mappedSize = 0;
+    m_index.clear();
+    if (m_file.isOpen()) m_file.close();
+}
+
+void AnalysisCache::buildIndex()
+{
+    m_index.clear();
+    qint64 size = m_file.size();
+    if (size <= kFileHeaderSize) return;
+
+    m_map = m_file.map(0, size);
+    if (!m_map) {
+        qDebug() << "[AnalysisCache] 内存映射失败:" << m_file.errorString();
+        return;
+    }
+    m_mappedSize = size;
+
+    qint64 pos = kFileHeaderSize;
+    while (pos < size) {
+        quint64 key = 0;
+        int len = decodeRecord(m_map + pos, size - pos, &key, nullptr);
+        if (len <= 0) break;
+        m_index.insert(key, pos);
+        pos += len;
+    }
+    if (pos < size) {
+        // 上次写入中断留下的残缺记录: 截掉, 后续从有效末尾追加
+        m_file.unmap(m_map);
+        m_file.resize(pos);
+        m_map = m_file.map(0, pos);
+        m_mappedSize = m_map ? pos : 0;
+    }
+}
+
+int AnalysisCache::decodeRecord(const uchar *data, qint64 avail, quint64 *key, Entry *e)
+{
+    if (avail < kRecordHeaderSize) return 0;
+    int n = data[20];
+    if (n <= 0) return 0;
+    int len = kRecordHeaderSize + n * n;
+    if (avail < len) return 0;
+
+    if (key) *key = qFromLittleEndian<quint64>(data);
+    if (e) {
+        e->boardSize = n;
+        e->scoreLead = bitsFloat(qFromLittleEndian<quint32>(data + 8));
+        e->winrate = bitsFloat(qFromLittleEndian<quint32>(data + 12));
+        e->visits = qFromLittleEndian<quint32>(data + 16);
+        e->bestMove = QString::fromLatin1(reinterpret_cast<const char *>(data + 21),
+                                          int(strnlen(reinterpret_cast<const char *>(data + 21), 3)));
+        e->ownership.resize(n * n);
+        std::memcpy(e->ownership.data(), data + kRecordHeaderSize, size_t(n * n));
+    }
+    return len;
+}
+
+QByteArray AnalysisCache::encodeRecord(quint64 key, const Entry &e)
+{
+    const int cells = e.boardSize * e.boardSize;
+    QByteArray rec(kRecordHeaderSize + cells, '\0');
+    uchar *d = reinterpret_cast<uchar *>(rec.data());
+    qToLittleEndian<quint64>(key, d);
+    qToLittleEndian<quint32>(floatBits(e.scoreLead), d + 8);
+    qToLittleEndian<quint32>(floatBits(e.winrate), d + 12);
+    qToLittleEndian<quint32>(e.visits, d + 16);
+    d[20] = uchar(e.boardSize);
+    QByteArray mv = e.bestMove.toLatin1().left(3);
+    std::memcpy(d + 21, mv.constData(), size_t(mv.size()));
+    if (e.ownership.size() == cells)
+        std::memcpy(d + kRecordHeaderSize, e.ownership.constData(), size_t(cells));
+    return rec;
+}
+
+bool AnalysisCache::readDiskEntry(qint64 offset, Entry *e)
+{
+    if (m_map && offset < m_mappedSize) {
+        return decodeRecord(m_map + offset, m_mappedSize - offset, nullptr, e) > 0;
+    }
+    // 本次运行中追加、尚未映射的记录直接从文件读取
+    if (!m_file.isOpen() || !m_file.seek(offset)) return false;
+    QByteArray head = m_file.read(kRecordHeaderSize);
+    if (head.size() < kRecordHeaderSize) return false;
+    int n = uchar(head[20]);
+    QByteArray rec = head + m_file.read(qint64(n) * n);
+    return decodeRecord(reinterpret_cast<const uchar *>(rec.constData()), rec.size(), nullptr, e) > 0;
+}
+
+bool AnalysisCache::lookup(quint64 key, QJsonObject *result)
+{
+    if (Entry *e = m_memory.object(key)) {
+        if (result) *result = responseFromEntry(*e);
+        return true;
+    }
+
+    auto it = m_index.constFind(key);
+    if (it == m_index.constEnd()) return false;
+    Entry *e = new Entry;
+    if (!readDiskEntry(it.value(), e)) {
+        delete e;
+        return false;
+    }
+    if (result) *result = responseFromEntry(*e);
+    m_memory.insert(key, e);
+    return true;
+}
+
+void AnalysisCache::store(quint64 key, int boardSize, const QJsonObject &response)
+{
+    if (boardSize <= 0 || boardSize > 255) return;
+    Entry e = entryFromResponse(boardSize, response);
+    if (e.ownership.size() != boardSize * boardSize) return;
+
+    m_memory.insert(key, new Entry(e));
+    if (!m_file.isOpen() || m_index.contains(key)) return;
+
+    qint64 offset = m_file.size();
+    if (!m_file.seek(offset)) return;
+    QByteArray rec = encodeRecord(key, e);
+    if (m_file.write(rec) == rec.size()) {
+        m_file.flush();
+        m_index.insert(key, offset);
+    }
+}
+
+AnalysisCache::Entry AnalysisCache::entryFromResponse(int boardSize, const QJsonObject &response)
+{
+    Entry e;
+    e.boardSize = boardSize;
+    QJsonObject rootInfo = response.value("rootInfo").toObject();
+    e.scoreLead = float(rootInfo.value("scoreLead").toDouble());
+    e.winrate = float(rootInfo.value("winrate").toDouble());
+    e.visits = quint32(qMax(0, rootInfo.value("visits").toInt()));
+
+    const QJsonArray moveInfos = response.value("moveInfos").toArray();
+    for (const auto &mv : moveInfos) {
+        QJsonObject info = mv.toObject();
+        if (info.value("order").toInt(-1) == 0) {
+            QString m = info.value("move").toString();
+            if (m.size() <= 3) e.bestMove = m;
+            break;
+        }
+    }
+
+    const QJsonArray own = response.value("ownership").toArray();
+    if (own.size() == boardSize * boardSize) {
+        e.ownership.resize(own.size());
+        for (int k = 0; k < own.size(); ++k) {
+            double v = qBound(-1.0, own[k].toDouble(), 1.0);
+            e.ownership[k] = qint8(std::lround(v * 127.0));
+        }
+    }
+    return e;
+}
+
+QJsonObject AnalysisCache::responseFromEntry(const Entry &e)
+{
+    QJsonObject rootInfo;
+    rootInfo["scoreLead"] = double(e.scoreLead);
+    rootInfo["winrate"] = double(e.winrate);
+    rootInfo["visits"] = int(e.visits);
+
+    QJsonArray own;
+    for (qint8 v : e.ownership) own.append(v / 127.0);
+
+    QJsonObject out;
+    out["rootInfo"] = rootInfo;
+    out["ownership"] = own;
+    if (!e.bestMove.isEmpty()) {
+        QJsonObject best;
+        best["move"] = e.bestMove;
+        best["order"] = 0;
+        out["moveInfos"] = QJsonArray{ best };
+    }
+    out["fromCache"] = true;
+    return out;
+}
@@ -0,0 +1,64 @@
+#ifndef ANALYSISCACHE_H
+#define ANALYSISCACHE_H
+
+#include <QCache>
+#include <QHash>
+#include <QFile>
+#include <QVector>
+#include <QJsonObject>
+
+/*
+ AnalysisCache: 分析结果缓存
+  - 键由局面哈希、棋盘大小、贴目、规则和访问数上限组合而成
+  - 内存中为 LRU (QCache), 未命中时再查磁盘存储
+  - 磁盘存储为只追加的定长记录文件, 打开时整体内存映射并建立 键 -> 偏移 索引
+  - 所有权按 int8 量化保存, 19 路一条记录约 385 字节
+*/
+class AnalysisCache
+{
+public:
+    // 单条缓存结果 (只保留界面需要的字段)
+    struct Entry {
+        int boardSize = 0;
+        float scoreLead = 0.0f;
+        float winrate = 0.0f;
+        quint32 visits = 0;
+        QString bestMove;           // GTP 坐标, 可为空
+        QVector<qint8> ownership;   // [-127, 127] 对应 [-1, 1]
+    };
+
+    explicit AnalysisCache(int memoryEntries = 512);
+    ~AnalysisCache();
+
+    // 打开 (或创建) 磁盘存储; 失败时仅使用内存缓存
+    bool open(const QString &path);
+    void close();
+    bool isOpen() const { return m_file.isOpen(); }
+
+    static quint64 makeKey(quint64 positionHash, int boardSize, double komi, const QString &rules, int maxVisits);
+
+    // 命中时以 KataGo 响应的格式写入 result (含 ownership/rootInfo/moveInfos)
+    bool lookup(quint64 key, QJsonObject *result);
+    // 保存一条最终分析结果
+    void store(quint64 key, int boardSize, const QJsonObject &response);
+
+    int memoryCount() const { return m_memory.size(); }
+    int diskCount() const { return m_index.size(); }
+
+private:
+    static Entry entryFromResponse(int boardSize, const QJsonObject &response);
+    static QJsonObject responseFromEntry(const Entry &e);
+    static QByteArray encodeRecord(quint64 key, const Entry &e);
+    // 从 data 解析一条记录; 返回记录长度, 数据不完整时返回 0
+    static int decodeRecord(const uchar *data, qint64 avail, quint64 *key, Entry *e);
+    bool readDiskEntry(qint64 offset, Entry *e);
+    void buildIndex();
+
+    QCache<quint64, Entry> m_memory;
+    QFile m_file;
+    uchar *m_map = nullptr;
+    qint64 m_mappedSize = 0;
+    QHash<quint64, qint64> m_index; // 键 -> 记录在文件中的偏移
+};
+
+#endif // ANALYSISCACHE_H
@@ -0,0 +1,241 @@
+#include "analysisservice.h"
+#include "engineconnection.h"
+
+#include <QCoreApplication>
+#include <QPointer>
+#include <QStandardPaths>
+#include <QDir>
+#include <QDebug>
+
+AnalysisService *AnalysisService::instance()
+{
+    static QPointer<AnalysisService> s_instance;
+    if (!s_instance) s_instance = new AnalysisService(QCoreApplication::instance());
+    return s_instance;
+}
+
+AnalysisService::AnalysisService(QObject *parent)
+    : QObject(parent)
+{
+}
+
+AnalysisService::~AnalysisService()
+{
+    stop();
+}
+
+void AnalysisService::setProcessCount(int count)
+{
+    m_processCount = qBound(1, count, 16);
+}
+
+void AnalysisService::setMaxInFlightPerProcess(int count)
+{
+    m_maxInFlight = qMax(1, count);
+}
+
+bool AnalysisService::start()
+{
+    if (isRunning()) return true;
+    stop();
+
+    QString exe, dir;
+    if (!EngineConnection::locateKataGo(&exe, &dir)) return false;
+
+    QStringList arguments;
+    arguments << "analysis" << "-model" << "model.bin" << "-config" << "gtp_config.cfg";
+
+    for (int k = 0; k < m_processCount; ++k) {
+        EngineConnection *engine = new EngineConnection(this);
+        connect(engine, &EngineConnection::analysisResponse, this, &AnalysisService::onEngineResponse);
+        connect(engine, &EngineConnection::analysisError, this, &AnalysisService::onEngineError);
+        connect(engine, &EngineConnection::ready, this, &AnalysisService::onEngineReady);
+        connect(engine, &EngineConnection::processError, this, &AnalysisService::onEngineProcessError);
+        engine->start(exe, arguments, dir);
+        m_engines.append(engine);
+    }
+    qDebug() << "[Analysis] 正在后台启动分析引擎进程:" << m_processCount;
+    return true;
+}
+
+void AnalysisService::stop()
+{
+    qDeleteAll(m_engines);
+    m_engines.clear();
+    m_owner.clear();
+    m_cacheKeys.clear();
+    m_interactiveQueue.clear();
+    m_backgroundQueue.clear();
+}
+
+bool AnalysisService::isRunning() const
+{
+    for (EngineConnection *engine : m_engines) {
+        if (engine->isRunning()) return true;
+    }
+    return false;
+}
+
+bool AnalysisService::isReady() const
+{
+    for (EngineConnection *engine : m_engines) {
+        if (engine->isReady()) return true;
+    }
+    return false;
+}
+
+bool AnalysisService::isAvailable()
+{
+    return EngineConnection::locateKataGo(nullptr, nullptr);
+}
+
+AnalysisCache &AnalysisService::cache()
+{
+    if (!m_cacheOpened) {
+        m_cacheOpened = true;
+        QString dir = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation);
+        if (!dir.isEmpty() && QDir().mkpath(dir)) m_cache.open(dir + "/analysis_cache.bin");
+    }
+    return m_cache;
+}
+
+QString AnalysisService::submit(QJsonObject query, Priority priority, quint64 cacheKey)
+{
+    QString id = query.value("id").toString();
+    if (id.isEmpty()) {
+        id = QStringLiteral("a%1").arg(m_nextId++);
+        query["id"] = id;
+    }
+
+    if (cacheKey != 0) {
+        QJsonObject cached;
+        if (cache().lookup(cacheKey, &cached)) {
+            // 命中缓存: 保持与引擎响应一致的异步语义, 调用方此时已能记录 id
+            cached["id"] = id;
+            QMetaObject::invokeMethod(this, [this, id, cached]() {
+                emit resultReady(id, cached);
+            }, Qt::QueuedConnection);
+            return id;
+        }
+        m_cacheKeys.insert(id, qMakePair(cacheKey, query.value("boardXSize").toInt()));
+    }
+
+    if (!start()) {
+        m_cacheKeys.remove(id);
+        return QString();
+    }
+    // 引擎内部同样按 priority 字段调度, 交互式请求可插到后台请求之前
+    query["priority"] = (priority == Interactive) ? 10 : 0;
+
+    if (priority == Interactive) m_interactiveQueue.enqueue(query);
+    else m_backgroundQueue.enqueue(query);
+    pump();
+    return id;
+}
+
+void AnalysisService::cancel(const QString &id)
+{
+    auto dropQueued = [&id](QQueue<QJsonObject> &queue) {
+        for (int k = 0; k < queue.size(); ++k) {
+            if (queue.at(k).value("id").toString() == id) {
+                queue.removeAt(k);
+                return true;
+            }
+        }
+        return false;
+    };
+    m_cacheKeys.remove(id);
+    if (dropQueued(m_interactiveQueue) || dropQueued(m_backgroundQueue)) return;
+
+    auto it = m_owner.find(id);
+    if (it == m_owner.end()) return;
+    EngineConnection *engine = m_engines.value(it.value());
+    m_owner.erase(it);
+    if (engine) engine->terminateAnalysis(id);
+    pump();
+}
+
+int AnalysisService::pickEngine() const
+{
+    int best = -1;
+    int bestLoad = m_maxInFlight;
+    for (int k = 0; k < m_engines.size(); ++k) {
+        EngineConnection *engine = m_engines[k];
+        if (!engine->isReady()) continue;
+        int load = engine->pendingAnalysisCount();
+        if (load < bestLoad) {
+            best = k;
+            bestLoad = load;
+        }
+    }
+    return best;
+}
+
+void AnalysisService::pump()
+{
+    while (!m_interactiveQueue.isEmpty() || !m_backgroundQueue.isEmpty()) {
+        int k = pickEngine();
+        if (k < 0) break;
+        QJsonObject query = !m_interactiveQueue.isEmpty() ? m_interactiveQueue.dequeue()
+                                                          : m_backgroundQueue.dequeue();
+        QString id = m_engines[k]->sendAnalysis(query);
+        if (!id.isEmpty()) m_owner.insert(id, k);
+    }
+}
+
+void AnalysisService::onEngineResponse(const QString &id, const QJsonObject &response)
+{
+    if (!response.value("isDuringSearch").toBool(false)) {
+        auto ck = m_cacheKeys.find(id);
+        if (ck != m_cacheKeys.end()) {
+            if (response.contains("ownership")) cache().store(ck.value().first, ck.value().second, response);
+            m_cacheKeys.erase(ck);
+        }
+    }
+
+    auto it = m_owner.find(id);
+    if (it != m_owner.end()) {
+        EngineConnection *engine = m_engines.value(it.value());
+        // 请求全部完成, 释放该引擎的一个在途名额
+        if (!engine || !engine->isAnalysisPending(id)) m_owner.erase(it);
+    }
+    emit resultReady(id, response);
+    pump();
+}
+
+void AnalysisService::onEngineError(const QString &id, const QString &message)
+{
+    m_owner.remove(id);
+    m_cacheKeys.remove(id);
+    qDebug() << "[Analysis] 请求失败:" << id << message;
+    emit queryFailed(id, message);
+    pump();
+}
+
+void AnalysisService::onEngineReady()
+{
+    // 只在第一个引擎就绪时通知一次
+    int readyCount = 0;
+    for (EngineConnection *engine : qAsConst(m_engines)) {
+        if (engine->isReady()) ++readyCount;
+    }
+    if (readyCount == 1) emit ready();
+    pump();
+}
+
+void AnalysisService::onEngineProcessError()
+{
+    if (isRunning()) return;
+    // 所有引擎均已失效: 排队中的请求无法再完成, 逐一通知调用方
+    auto failAll = [this](QQueue<QJsonObject> &queue) {
+        while (!queue.isEmpty()) {
+            emit queryFailed(queue.dequeue().value("id").toString(), tr("分析引擎不可用"));
+        }
+    };
+    failAll(m_interactiveQueue);
+    failAll(m_backgroundQueue);
+    const QList<QString> inFlight = m_owner.keys();
+    m_owner.clear();
+    m_cacheKeys.clear();
+    for (const QString &id : inFlight) emit queryFailed(id, tr("分析引擎不可用"));
+}
@@ -0,0 +1,97 @@
+#ifndef ANALYSISSERVICE_H
+#define ANALYSISSERVICE_H
+
+#include <QObject>
+#include <QVector>
+#include <QQueue>
+#include <QHash>
+#include <QJsonObject>
+#include "analysiscache.h"
+
+class EngineConnection;
+
+/*
+ AnalysisService: 进程内共享的 KataGo 分析服务
+  - 所有窗口共用同一组分析引擎进程 (数量可配置), 避免每个窗口各自加载模型
+  - 请求按 id 多路复用: 调用方保存 submit() 返回的 id, 只处理属于自己的响应
+  - 交互式请求 (形势判断) 优先于后台请求 (复盘/批量分析) 派发
+  - 引擎在第一次 submit() 时才异步启动; 模型加载完成前的请求在本地排队, 就绪后再派发
+  - 带缓存键的请求先查 AnalysisCache, 命中时不经过引擎直接返回
+*/
+class AnalysisService : public QObject
+{
+    Q_OBJECT
+public:
+    enum Priority {
+        Background = 0,  // 后台请求
+        Interactive = 1  // 用户正在等待的请求
+    };
+
+    static AnalysisService *instance();
+
+    // 引擎进程数量与每个进程的最大在途请求数 (需在 start() 之前设置)
+    void setProcessCount(int count);
+    int processCount() const { return m_processCount; }
+    void setMaxInFlightPerProcess(int count);
+
+    // 异步启动引擎进程 (已启动则直接返回 true); 找不到 KataGo 时返回 false
+    bool start();
+    // 应用启动时预热: 提前加载模型, 使第一次形势判断无需等待
+    void prewarm() { start(); }
+    void stop();
+    // 至少有一个引擎进程正在启动或运行
+    bool isRunning() const;
+    // 至少有一个引擎已加载完模型
+    bool isReady() const;
+    // 本机是否安装了 KataGo (不启动进程)
+    static bool isAvailable();
+
+    // 提交一条分析请求, 返回全局唯一的请求 id; 失败返回空字符串
+    // cacheKey 非 0 时先查缓存 (结果仍通过 resultReady 异步返回), 最终结果写回缓存
+    QString submit(QJsonObject query, Priority priority = Interactive, quint64 cacheKey = 0);
+    // 取消一条请求: 仍在排队则直接丢弃, 已派发则通知引擎终止
+    void cancel(const QString &id);
+
+    // 直接读写结果缓存 (供一次请求覆盖多个局面的调用方, 如整局复盘)
+    bool cachedResult(quint64 cacheKey, QJsonObject *response) { return cache().lookup(cacheKey, response); }
+    void storeResult(quint64 cacheKey, int boardSize, const QJsonObject &response) { cache().store(cacheKey, boardSize, response); }
+
+signals:
+    // 第一个引擎完成模型加载
+    void ready();
+    // 分析响应 (同一 id 可能对应多条)
+    void resultReady(const QString &id, const QJsonObject &response);
+    void queryFailed(const QString &id, const QString &message);
+
+private slots:
+    void onEngineResponse(const QString &id, const QJsonObject &response);
+    void onEngineError(const QString &id, const QString &message);
+    void onEngineReady();
+    void onEngineProcessError();
+
+private:
+    explicit AnalysisService(QObject *parent = nullptr);
+    ~AnalysisService();
+
+    // 打开磁盘缓存 (第一次使用时)
+    AnalysisCache &cache();
+    // 将排队的请求派发给空闲的引擎
+    void pump();
+    // 选择已就绪、在途请求最少且未满的引擎; 没有可用引擎返回 -1
+    int pickEngine() const;
+
+    int m_processCount = 1;
+    int m_maxInFlight = 4;
+    int m_nextId = 1;
+    QVector<EngineConnection *> m_engines;
+    QQueue<QJsonObject> m_interactiveQueue;
+    QQueue<QJsonObject> m_backgroundQueue;
+    // 请求 id -> 所在引擎序号
+    QHash<QString, int> m_owner;
+    AnalysisCache m_cache;
+    bool m_cacheOpened = false;
+    // 请求 id -> 缓存键与棋盘路数, 最终结果到达时写入缓存
+    QHash<QString, QPair<quint64, int>> m_cacheKeys;
+};
+
+#endif // ANALYSISSERVICE_H
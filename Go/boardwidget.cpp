@@ -1,13 +1,19 @@
 #include "boardwidget.h"
 #include "ai_random.h"
 #include "networkmanager.h"
+#include "stonespritecache.h"
+#include "perfmonitor.h"
 
 #include <QPainter>
+#include <QPaintEvent>
+#include <QResizeEvent>
+#include <QtMath>
 #include <QMouseEvent>
 #include <QMessageBox>
 #include <QTimer>
 #include <QJsonObject>
 #include <QJsonDocument>
+#include <QJsonArray>
 #include <QDebug>
 #include <QPointer>
 
@@ -21,8 +27,8 @@ BoardWidget::BoardWidget(QWidget *parent)
       m_networkMode(false),
       m_localColor(0)
 {
-    setAutoFillBackground(true);
-    setBackgroundRole(QPalette::Base);
+    // 底图覆盖整个控件, 无需 Qt 预先填充背景
+    setAttribute(Qt::WA_OpaquePaintEvent);
 }
 
 void BoardWidget::setNetworkManager(NetworkManager *mgr)
@@ -32,21 +38,23 @@ void BoardWidget::setNetworkManager(NetworkManager *mgr)
     // 断开旧的网络连接, 避免重复
     if (m_net) {
         disconnect(m_net, nullptr, this, nullptr);
+        m_net->dispatcher()->unsubscribe(this);
     }
     m_net = mgr;
     if (!m_net) return;
 
-    // 在lambda表达式中使用 QPointer 作为安全保护, 防止 BoardWidget 对象被删除后出现悬挂指针
-    QPointer<BoardWidget> guard(this);
-
-    connect(m_net, &NetworkManager::jsonReceived, this,
-        [guard](const QJsonObject &obj) {
-            if (!guard) return;
-            BoardWidget *self = guard.data();
-
-            QString t = obj.value("type").toString();
-
-            if (t == "move" || (t == "game_update" && obj.value("subtype").toString() == "move")) {
+    // 只订阅棋盘关心的消息类型; 本对象销毁后订阅自动失效
+    using Msg = MessageDispatcher;
+    m_net->dispatcher()->subscribe(
+        {Msg::Move, Msg::GameUpdate, Msg::Delta, Msg::MoveAck, Msg::ResyncRequest, Msg::Pass,
+         Msg::Turn, Msg::Start, Msg::Resign, Msg::Matched, Msg::Sync},
+        this,
+        [this](Msg::Type t, const QJsonObject &obj) {
+            // 观战与对局共用一条连接, 服务端转发给观战者的消息带有被观战房间的 room_id
+            if (t != Msg::Matched && obj.contains("room_id") && obj.value("room_id").toString() != m_roomId) return;
+            const QString subtype = t == Msg::GameUpdate ? obj.value("subtype").toString() : QString();
+
+            if (t == Msg::Move || subtype == "move") {
                 int i = -1, j = -1;
                 if (obj.contains("i") && obj.contains("j")) {
                     i = obj.value("i").toInt();
@@ -56,50 +64,68 @@ void BoardWidget::setNetworkManager(NetworkManager *mgr)
                     j = obj.value("y").toInt();
                 }
                 if (i >= 0 && j >= 0) {
-                    self->applyRemoteMove(i, j);
+                    applyRemoteMove(i, j);
                 }
-            } else if (t == "pass" || (t == "game_update" && obj.value("subtype").toString() == "pass")) {
-                self->m_board.pass();
-                emit self->stateChanged();
-                self->update();
-            } else if (t == "turn") {
+            } else if (t == Msg::Delta) {
+                applyRemoteDelta(obj);
+            } else if (t == Msg::MoveAck) {
+                onMoveAck(obj);
+            } else if (t == Msg::ResyncRequest) {
+                sendSnapshot();
+            } else if (t == Msg::Pass || subtype == "pass") {
+                auto prevLast = m_board.lastMove();
+                m_board.pass();
+                ++m_seq;
+                emit stateChanged();
+                updateMoveRegion(prevLast);
+            } else if (t == Msg::Turn) {
+                // 轮到哪方不影响棋盘画面, 无需重绘
                 int cur = obj.value("currentPlayer").toInt();
-                self->m_board.setCurrentPlayer(cur);
-                emit self->stateChanged();
-                self->update();
-            } else if (t == "start") {
+                m_board.setCurrentPlayer(cur);
+                emit stateChanged();
+            } else if (t == Msg::Start) {
                 QString color = obj.value("color").toString().toLower();
-                if (color == "black") self->setLocalPlayerColor(1);
-                else self->setLocalPlayerColor(2);
-                self->newGame();
-                self->setNetworkModeEnabled(true);
-                emit self->stateChanged();
-                self->update();
-            } else if (t == "resign" || (t == "game_update" && obj.value("subtype").toString() == "resign")) {
-                QMessageBox::information(self, QObject::tr("消息"), QObject::tr("对方认输，你获胜"));
-                self->setNetworkModeEnabled(false);
-                emit self->stateChanged();
-                self->update();
-            } else if (t == "matched") {
+                if (color == "black") setLocalPlayerColor(1);
+                else setLocalPlayerColor(2);
+                newGame();
+                setNetworkModeEnabled(true);
+                emit stateChanged();
+                update();
+            } else if (t == Msg::Resign || subtype == "resign") {
+                QMessageBox::information(this, QObject::tr("消息"), QObject::tr("对方认输，你获胜"));
+                setNetworkModeEnabled(false);
+                emit stateChanged();
+                update();
+            } else if (t == Msg::Matched) {
                 QString color = obj.value("color").toString().toLower();
-                if (color == "black") self->setLocalPlayerColor(1);
-                else self->setLocalPlayerColor(2);
-                self->setNetworkModeEnabled(false);
-                emit self->stateChanged();
-                self->update();
-            } else if (t == "sync") {
-                QString boardStr = obj.value("board").toString();
+                if (color == "black") setLocalPlayerColor(1);
+                else setLocalPlayerColor(2);
+                setNetworkModeEnabled(false);
+                emit stateChanged();
+                update();
+            } else if (t == Msg::Sync) {
                 int cur = obj.value("currentPlayer").toInt();
-                bool ok = self->loadBoardFromSerialized(boardStr, cur);
+                std::string before = m_board.serialize();
+                auto prevLast = m_board.lastMove();
+                bool ok = false;
+                if (obj.contains("packed")) {
+                    // 压缩盘面 (2 位/点)
+                    ok = m_board.unpackBoard(QByteArray::fromBase64(obj.value("packed").toString().toLatin1()));
+                    if (ok && (cur == 1 || cur == 2)) m_board.setCurrentPlayer(cur);
+                } else {
+                    ok = loadBoardFromSerialized(obj.value("board").toString(), cur);
+                }
                 if (ok) {
-                    emit self->stateChanged();
-                    self->update();
+                    if (obj.contains("seq")) m_seq = quint32(obj.value("seq").toDouble());
+                    m_resyncPending = false;
+                    m_pendingMoves.clear();
+                    emit stateChanged();
+                    updateChangedPoints(before);
+                    updateMoveRegion(prevLast);
                 }
             }
             // 在 BoardWidget 层面忽略 "opponent_joined" 消息
-        },
-        Qt::QueuedConnection
-    );
+        });
 }
 
 
@@ -135,6 +161,11 @@ bool BoardWidget::loadBoardFromSerialized(const QString &ser, int currentPlayer)
 
 void BoardWidget::newGame()
 {
+    m_seq = 0;
+    m_resyncPending = false;
+    m_pendingMoves.clear();
+    m_replaying = false;
+    m_replayBoard.clear();
     m_board.reset();
     clearAnalysis();
     emit stateChanged();
@@ -158,52 +189,105 @@ void BoardWidget::playerPass()
         if (m_localColor == 0) return;
         if (m_board.currentPlayer() != m_localColor) return;
     }
+    const bool send = m_networkMode && m_net && m_net->isConnected();
+    Goban before;
+    if (send) before = m_board;
+    auto prevLast = m_board.lastMove();
     m_board.pass();
+    ++m_seq;
 
-    if (m_networkMode && m_net && m_net->isConnected()) {
-        QJsonObject obj;
-        obj["type"] = "pass";
-        m_net->sendJson(obj);
-
-        // 发送当前回合给对方
-        QJsonObject turn;
-        turn["type"] = "turn";
-        turn["currentPlayer"] = m_board.currentPlayer();
-        m_net->sendJson(turn);
+    if (send) {
+        m_pendingMoves.append({m_seq, before, m_board.hash()});
+        sendDelta();
     }
 
     emit stateChanged();
-    update();
+    updateMoveRegion(prevLast);
     maybeAIMove();
 }
 
-void BoardWidget::displayAnalysis(const QVector<double> &ownershipMap)
+void BoardWidget::displayAnalysis(const QVector<double> &ownershipMap, double scoreLead, const QPoint &bestMove)
 {
-    m_ownershipMap = ownershipMap;
-    update(); // 触发重绘
+    int n = m_board.size();
+    // 所有权数据长度不符时视为无效 (例如搜索初期尚未给出)
+    QVector<double> ownership = (ownershipMap.size() == n * n) ? ownershipMap : QVector<double>();
+    if (ownership.isEmpty() && m_ownershipMap.isEmpty()) {
+        // 没有所有权图: 只需重绘新旧推荐点与目差文字
+        QRegion region(0, 0, width(), m_viewMargin);
+        if (m_bestMove.x() >= 0) region += cellRect(m_bestMove.y(), m_bestMove.x());
+        if (bestMove.x() >= 0) region += cellRect(bestMove.y(), bestMove.x());
+        m_scoreLead = scoreLead;
+        m_bestMove = bestMove;
+        update(region);
+        return;
+    }
+    m_ownershipMap = ownership;
+    m_scoreLead = scoreLead;
+    m_bestMove = bestMove;
+    updateOwnershipImage();
+    update(); // 所有权图覆盖整个棋盘
+}
+
+void BoardWidget::updateOwnershipImage()
+{
+    int n = m_board.size();
+    if (m_ownershipMap.size() != n * n) {
+        m_ownershipImage = QImage();
+        return;
+    }
+    // 搜索途中的连续更新复用同一张图, 不重新分配
+    if (m_ownershipImage.width() != n || m_ownershipImage.height() != n) {
+        m_ownershipImage = QImage(n, n, QImage::Format_ARGB32_Premultiplied);
+    }
+    // 连续色阶: 黑方 (正值) 蓝色, 白方 (负值) 红色, 透明度随把握程度线性增加
+    const int maxAlpha = 110;
+    for (int i = 0; i < n; ++i) {
+        QRgb *line = reinterpret_cast<QRgb *>(m_ownershipImage.scanLine(i));
+        for (int j = 0; j < n; ++j) {
+            double owner = qBound(-1.0, m_ownershipMap[i * n + j], 1.0);
+            int alpha = qRound(qAbs(owner) * maxAlpha);
+            line[j] = owner >= 0 ? qPremultiply(qRgba(0, 0, 255, alpha))
+                                 : qPremultiply(qRgba(255, 0, 0, alpha));
+        }
+    }
 }
 
 void BoardWidget::clearAnalysis()
 {
-    if (!m_ownershipMap.isEmpty()) {
+    if (!m_ownershipMap.isEmpty() || m_bestMove.x() >= 0) {
         m_ownershipMap.clear();
+        m_ownershipImage = QImage();
+        m_bestMove = QPoint(-1, -1);
+        m_scoreLead = 0.0;
         update(); // 触发重绘
     }
 }
 
-void BoardWidget::paintEvent(QPaintEvent *)
+void BoardWidget::updateLayout()
 {
-    QPainter p(this);
-    p.setRenderHint(QPainter::Antialiasing, true);
-
     int n = m_board.size();
     int w = width(), h = height();
     int avail = qMin(w, h) - 2*m_viewMargin;
     if (avail < 0) avail = 0;
     m_gridSize = (n > 1) ? (avail / (n - 1)) : 0;
     int boardSize = m_gridSize * (n - 1);
-    int left = (w - boardSize) / 2;
-    int top = (h - boardSize) / 2;
+    m_boardLeft = (w - boardSize) / 2;
+    m_boardTop = (h - boardSize) / 2;
+}
+
+void BoardWidget::rebuildBoardLayer()
+{
+    updateLayout();
+    const qreal dpr = devicePixelRatioF();
+    m_boardLayer = QPixmap(qCeil(width() * dpr), qCeil(height() * dpr));
+    m_boardLayer.setDevicePixelRatio(dpr);
+
+    int n = m_board.size();
+    int boardSize = m_gridSize * (n - 1);
+    int left = m_boardLeft, top = m_boardTop;
+
+    QPainter p(&m_boardLayer);
+    p.setRenderHint(QPainter::Antialiasing, true);
 
     // 绘制棋盘背景
     p.fillRect(rect(), QColor(238, 207, 161));
@@ -215,70 +299,102 @@ void BoardWidget::paintEvent(QPaintEvent *)
         p.drawLine(left + i*m_gridSize, top, left + i*m_gridSize, top + boardSize);
     }
 
-    if (!m_ownershipMap.isEmpty()) {
-        p.setPen(Qt::NoPen);
-        int n = m_board.size();
-        for (int i = 0; i < n; ++i) {
-            for (int j = 0; j < n; ++j) {
-                double owner = m_ownershipMap[i * n + j];
-                QPoint center(left + j*m_gridSize, top + i*m_gridSize);
-                QRect r(center.x() - m_gridSize/2, center.y() - m_gridSize/2, m_gridSize, m_gridSize);
-
-                if (owner > 0.75) { // 强黑区域
-                    p.setBrush(QColor(0, 0, 255, 70)); // 蓝色半透明
-                    p.drawRect(r);
-                } else if (owner < -0.75) { // 强白区域
-                    p.setBrush(QColor(255, 0, 0, 70)); // 红色半透明
-                    p.drawRect(r);
-                }
-            }
-        }
-    }
-
     // 绘制19路棋盘的星位
-    QVector<QPoint> stars;
     if (n == 19) {
         int coords[] = {3, 9, 15};
+        p.setBrush(Qt::black);
         for (int a : coords)
             for (int b : coords)
-                stars.append(QPoint(left + a*m_gridSize, top + b*m_gridSize));
+                p.drawEllipse(QPoint(left + a*m_gridSize, top + b*m_gridSize), 4, 4);
+    }
+}
+
+void BoardWidget::resizeEvent(QResizeEvent *event)
+{
+    QWidget::resizeEvent(event);
+    updateLayout();
+    // 下一次绘制时按新尺寸重建底图
+    m_boardLayer = QPixmap();
+}
+
+void BoardWidget::paintEvent(QPaintEvent *event)
+{
+    PerfScope perf(PerfMonitor::Paint);
+    const qreal dpr = devicePixelRatioF();
+    if (m_boardLayer.isNull() || m_boardLayer.devicePixelRatioF() != dpr) rebuildBoardLayer();
+
+    QPainter p(this);
+    const QRect dirty = event->rect();
+    // 底图: 只拷贝需要重绘的区域
+    p.drawPixmap(QRectF(dirty), m_boardLayer,
+                 QRectF(dirty.x() * dpr, dirty.y() * dpr, dirty.width() * dpr, dirty.height() * dpr));
+
+    int n = m_board.size();
+    int left = m_boardLeft, top = m_boardTop;
+
+    // 只处理与重绘区域相交的交叉点, 单手落子的重绘开销与变化的点数成正比
+    int iMin = 0, iMax = n - 1, jMin = 0, jMax = n - 1;
+    if (m_gridSize > 0) {
+        iMin = qBound(0, (dirty.top() - top) / m_gridSize - 1, n - 1);
+        iMax = qBound(0, (dirty.bottom() - top) / m_gridSize + 1, n - 1);
+        jMin = qBound(0, (dirty.left() - left) / m_gridSize - 1, n - 1);
+        jMax = qBound(0, (dirty.right() - left) / m_gridSize + 1, n - 1);
     }
-    p.setBrush(Qt::black);
-    for (auto &pt : stars) {
-        p.drawEllipse(pt, 4, 4);
+    const QRegion &region = event->region();
+    auto visible = [&](int i, int j) { return region.intersects(cellRect(i, j)); };
+
+    if (!m_ownershipImage.isNull() && m_gridSize > 0) {
+        // 一次缩放绘制整张所有权纹理, 每个像素恰好覆盖一个格子
+        QRect target(left - m_gridSize/2, top - m_gridSize/2, n*m_gridSize, n*m_gridSize);
+        p.drawImage(target, m_ownershipImage);
     }
 
-    // 绘制棋子
-    for (int i = 0; i < n; ++i) {
-        for (int j = 0; j < n; ++j) {
-            int v = m_board.get(i, j);
-            if (v == 0) continue;
-            QPoint center(left + j*m_gridSize, top + i*m_gridSize);
-            bool isDead = false;
-            if (!m_ownershipMap.isEmpty())
-            {
-              double owner = m_ownershipMap[i * n + j];
-              // 如果是黑棋，但所有权判定为强白，则标记为死棋
-              if (v == 1 && owner < -0.85) isDead = true;
-              // 如果是白棋，但所有权判定为强黑，则标记为死棋
-              if (v == 2 && owner > 0.85) isDead = true;
-            }
-            p.setPen(Qt::black);
-            if (v == 1) { // 黑棋
-                p.setBrush(Qt::black);
-                p.drawEllipse(center, m_gridSize/2 - 2, m_gridSize/2 - 2);
-            } else { // 白棋
-                p.setBrush(Qt::white);
-                p.drawEllipse(center, m_gridSize/2 - 2, m_gridSize/2 - 2);
-                p.setPen(Qt::gray);
-                p.drawEllipse(center, m_gridSize/2 - 2, m_gridSize/2 - 2);
+    // 绘制棋子: 直接贴预渲染的贴图
+    const int radius = m_gridSize/2 - 2;
+    if (radius > 0) {
+        const QPixmap &black = StoneSpriteCache::sprite(1, radius, dpr);
+        const QPixmap &white = StoneSpriteCache::sprite(2, radius, dpr);
+        const QPoint offset = StoneSpriteCache::offset(radius);
+        for (int i = iMin; i <= iMax; ++i) {
+            for (int j = jMin; j <= jMax; ++j) {
+                int v = displayedStone(i, j);
+                if (v == 0 || !visible(i, j)) continue;
+                p.drawPixmap(pointCenter(i, j) + offset, v == 1 ? black : white);
             }
         }
     }
+
+    // 以下为叠加层
+    p.setRenderHint(QPainter::Antialiasing, true);
+
+    // 最后一手标记: 棋子中心的反色小圆
+    auto last = m_replaying ? m_replayLastMove : m_board.lastMove();
+    if (last.first >= 0 && radius > 0 && displayedStone(last.first, last.second) != 0) {
+        bool blackStone = displayedStone(last.first, last.second) == 1;
+        p.setPen(QPen(blackStone ? Qt::white : Qt::black, 2));
+        p.setBrush(Qt::NoBrush);
+        p.drawEllipse(pointCenter(last.first, last.second), radius/3, radius/3);
+    }
+
+    // 分析推荐点与目差
+    if (m_bestMove.x() >= 0 && m_bestMove.y() >= 0 && displayedStone(m_bestMove.y(), m_bestMove.x()) == 0) {
+        QPoint center = pointCenter(m_bestMove.y(), m_bestMove.x());
+        p.setBrush(Qt::NoBrush);
+        p.setPen(QPen(QColor(0, 160, 0), 3));
+        p.drawEllipse(center, m_gridSize/3, m_gridSize/3);
+    }
+    if (!m_ownershipMap.isEmpty()) {
+        QString lead = (m_scoreLead >= 0) ? tr("黑 +%1").arg(m_scoreLead, 0, 'f', 1)
+                                          : tr("白 +%1").arg(-m_scoreLead, 0, 'f', 1);
+        p.setPen(Qt::black);
+        p.drawText(QRect(4, 2, width() - 8, m_viewMargin), Qt::AlignLeft | Qt::AlignVCenter, lead);
+    }
 }
 
 void BoardWidget::mouseReleaseEvent(QMouseEvent *event)
 {
+    // 回放时棋盘只读
+    if (m_replaying) return;
     clearAnalysis();
     int n = m_board.size();
     int w = width(), h = height();
@@ -311,46 +427,232 @@ void BoardWidget::mouseReleaseEvent(QMouseEvent *event)
     tryPlay(i, j, true);
 }
 
+int BoardWidget::displayedStone(int i, int j) const
+{
+    if (!m_replaying) return m_board.get(i, j);
+    int n = m_board.size();
+    if (i < 0 || j < 0 || i >= n || j >= n || int(m_replayBoard.size()) != n*n) return 0;
+    return m_replayBoard[size_t(i*n + j)] - '0';
+}
+
+void BoardWidget::showReplayPosition(const std::string &board, const std::pair<int,int> &lastMove)
+{
+    int n = m_board.size();
+    if (int(board.size()) != n*n) return;
+    // 与当前画面比较, 拖动进度条时每帧只重绘变化的几个交叉点
+    const std::string before = m_replaying ? m_replayBoard : m_board.serialize();
+    const auto prevLast = m_replaying ? m_replayLastMove : m_board.lastMove();
+    m_replaying = true;
+    m_replayBoard = board;
+    m_replayLastMove = lastMove;
+
+    QRegion region;
+    for (int k = 0; k < n*n; ++k) {
+        if (before[size_t(k)] != board[size_t(k)]) region += cellRect(k / n, k % n);
+    }
+    if (prevLast.first >= 0) region += cellRect(prevLast.first, prevLast.second);
+    if (lastMove.first >= 0) region += cellRect(lastMove.first, lastMove.second);
+    if (!region.isEmpty()) update(region);
+}
+
+void BoardWidget::exitReplay()
+{
+    if (!m_replaying) return;
+    const std::string before = m_replayBoard;
+    const auto prevLast = m_replayLastMove;
+    m_replaying = false;
+    m_replayBoard.clear();
+    m_replayLastMove = {-1, -1};
+    updateChangedPoints(before);
+    updateMoveRegion(prevLast);
+}
+
+QRect BoardWidget::cellRect(int i, int j) const
+{
+    // 覆盖整个格子, 多留 1 像素给抗锯齿边缘
+    int half = m_gridSize/2 + 1;
+    QPoint c = pointCenter(i, j);
+    return QRect(c.x() - half, c.y() - half, 2*half + 1, 2*half + 1);
+}
+
+void BoardWidget::updateMoveRegion(const std::pair<int,int> &prevLastMove)
+{
+    QRegion region;
+    if (prevLastMove.first >= 0) region += cellRect(prevLastMove.first, prevLastMove.second);
+    auto last = m_board.lastMove();
+    if (last.first >= 0) region += cellRect(last.first, last.second);
+    for (const auto &pt : m_board.lastCaptures()) region += cellRect(pt.first, pt.second);
+    if (!region.isEmpty()) update(region);
+}
+
+void BoardWidget::updateChangedPoints(const std::string &before)
+{
+    const std::string after = m_board.serialize();
+    if (before.size() != after.size()) {
+        update();
+        return;
+    }
+    int n = m_board.size();
+    QRegion region;
+    for (int k = 0; k < int(after.size()); ++k) {
+        if (before[k] != after[k]) region += cellRect(k / n, k % n);
+    }
+    if (!region.isEmpty()) update(region);
+}
+
 void BoardWidget::tryPlay(int i, int j, bool sendNetwork)
 {
     QString err;
+    // 仅当是本地玩家落子且允许时, 才将数据发送到服务器
+    const bool send = sendNetwork && m_networkMode && m_net && m_net->isConnected();
+    Goban before;
+    if (send) before = m_board;
+    auto prevLast = m_board.lastMove();
     bool ok = m_board.play(i, j, &err);
     if (!ok) {
         QMessageBox::warning(this, tr("非法落子"), err);
         return;
     }
 
-    // 仅当是本地玩家落子且允许时, 才将数据发送到服务器
-    if (sendNetwork && m_networkMode && m_net && m_net->isConnected()) {
-        QJsonObject obj;
-        obj["type"] = "move";
-        obj["x"] = i;
-        obj["y"] = j;
-        m_net->sendJson(obj);
-
-        // 同时发送回合信息以同步
-        QJsonObject turn;
-        turn["type"] = "turn";
-        turn["currentPlayer"] = m_board.currentPlayer();
-        m_net->sendJson(turn);
+    ++m_seq;
+
+    // 先在本地生效, 不等服务端往返
+    if (send) {
+        m_pendingMoves.append({m_seq, before, m_board.hash()});
+        sendDelta();
     }
 
     emit stateChanged();
-    update();
+    updateMoveRegion(prevLast);
     maybeAIMove();
 }
 
 void BoardWidget::applyRemoteMove(int i, int j)
 {
     QString err;
+    auto prevLast = m_board.lastMove();
     bool ok = m_board.play(i, j, &err);
     if (!ok) {
-        // 远端落子失败，提示并尝试请求同步（当前简化为仅提示）
-        QMessageBox::warning(this, tr("远端落子失败"), err);
+        // 远端落子失败: 双方盘面已不一致, 请求全量同步
+        qDebug() << "[Board] 远端落子失败:" << err;
+        requestResync();
         return;
     }
+    ++m_seq;
     emit stateChanged();
-    update();
+    updateMoveRegion(prevLast);
+}
+
+void BoardWidget::sendDelta()
+{
+    // 一条消息包含落子 (虚着为 -1,-1)、提子、下一手与局面哈希, 代替原来的 move + turn 两条
+    auto last = m_board.lastMove();
+    QJsonArray captures;
+    for (const auto &pt : m_board.lastCaptures()) {
+        captures.append(pt.first);
+        captures.append(pt.second);
+    }
+    QJsonObject delta;
+    delta["type"] = "delta";
+    delta["seq"] = double(m_seq);
+    delta["x"] = last.first;
+    delta["y"] = last.second;
+    delta["next"] = m_board.currentPlayer();
+    delta["hash"] = QString::number(m_board.hash(), 16);
+    delta["captures"] = captures;
+    m_net->sendJson(delta);
+}
+
+void BoardWidget::applyRemoteDelta(const QJsonObject &delta)
+{
+    quint32 seq = quint32(delta.value("seq").toDouble());
+    if (seq <= m_seq) return; // 重复或过期
+    if (seq != m_seq + 1) {
+        qDebug() << "[Board] 增量序号跳变:" << m_seq << "->" << seq;
+        requestResync();
+        return;
+    }
+
+    int x = delta.value("x").toInt(-1);
+    int y = delta.value("y").toInt(-1);
+    int next = delta.value("next").toInt();
+    auto prevLast = m_board.lastMove();
+    // 落子方由 next 推出, 不依赖本地记录的轮次
+    if (next == 1 || next == 2) m_board.setCurrentPlayer(3 - next);
+    bool ok = true;
+    if (x < 0 || y < 0) m_board.pass();
+    else ok = m_board.play(x, y);
+    if (!ok) {
+        requestResync();
+        return;
+    }
+    m_seq = seq;
+    confirmPendingUpTo(seq - 1);
+
+    // 校验: 提子数与局面哈希必须与对方一致
+    bool consistent = QString::number(m_board.hash(), 16) == delta.value("hash").toString()
+            && int(m_board.lastCaptures().size()) * 2 == delta.value("captures").toArray().size();
+    emit stateChanged();
+    updateMoveRegion(prevLast);
+    if (!consistent) {
+        qDebug() << "[Board] 增量校验失败, seq =" << seq;
+        requestResync();
+    }
+}
+
+void BoardWidget::onMoveAck(const QJsonObject &ack)
+{
+    const quint32 seq = quint32(ack.value("seq").toDouble());
+    int k = 0;
+    while (k < m_pendingMoves.size() && m_pendingMoves[k].seq != seq) ++k;
+    if (k == m_pendingMoves.size()) return; // 已确认或已回滚
+
+    if (ack.value("accepted").toBool()) {
+        const QString hash = ack.value("hash").toString();
+        const bool diverged = !hash.isEmpty() && hash != QString::number(m_pendingMoves[k].hash, 16);
+        confirmPendingUpTo(seq);
+        if (diverged) {
+            qDebug() << "[Board] 落子确认的局面哈希不一致, seq =" << seq;
+            requestResync();
+        }
+        return;
+    }
+
+    // 被拒绝: 回滚到这一手之前, 之后的本地落子一并作废
+    qDebug() << "[Board] 落子被拒绝, seq =" << seq << ack.value("msg").toString();
+    const std::string shown = m_board.serialize();
+    auto prevLast = m_board.lastMove();
+    m_board = m_pendingMoves[k].before;
+    m_seq = seq - 1;
+    m_pendingMoves.erase(m_pendingMoves.begin() + k, m_pendingMoves.end());
+    emit stateChanged();
+    updateChangedPoints(shown);
+    updateMoveRegion(prevLast);
+    // 服务端期望的序号与本地不同, 说明盘面已不一致
+    if (ack.contains("expected") && quint32(ack.value("expected").toDouble()) != seq) requestResync();
+}
+
+void BoardWidget::confirmPendingUpTo(quint32 seq)
+{
+    while (!m_pendingMoves.isEmpty() && m_pendingMoves.first().seq <= seq) m_pendingMoves.removeFirst();
+}
+
+void BoardWidget::sendSnapshot()
+{
+    if (!m_net || !m_net->isConnected()) return;
+    QJsonObject sync;
+    sync["type"] = "sync";
+    sync["seq"] = double(m_seq);
+    sync["currentPlayer"] = m_board.currentPlayer();
+    sync["packed"] = QString::fromLatin1(m_board.packBoard().toBase64());
+    m_net->sendJson(sync);
+}
+
+void BoardWidget::requestResync()
+{
+    if (m_resyncPending || !m_net || !m_net->isConnected()) return;
+    m_resyncPending = true;
+    m_net->sendJson(QJsonObject{{"type", "resync_request"}});
 }
 
 void BoardWidget::playLocalMove(int i, int j)
@@ -364,11 +666,13 @@ void BoardWidget::playLocalMove(int i, int j)
 void BoardWidget::doAIMove(int difficulty)
 {
     QPointer<BoardWidget> guard(this);
-    QTimer::singleShot(1, this, [guard, difficulty]() {
+    const qint64 perfStart = PerfMonitor::isEnabled() ? PerfMonitor::nowUs() : -1;
+    QTimer::singleShot(1, this, [guard, difficulty, perfStart]() {
         if (!guard) return;
         BoardWidget *self = guard.data();
 
         int cur = self->m_board.currentPlayer();
+        auto prevLast = self->m_board.lastMove();
         if (difficulty == 0) {
             auto mv = AIRandom::chooseMove(self->m_board, cur);
             if (mv.first == -1) {
@@ -383,7 +687,7 @@ void BoardWidget::doAIMove(int difficulty)
                 }
             }
             emit self->stateChanged();
-            self->update();
+            self->updateMoveRegion(prevLast);
         } else {
             auto mv = AIRandom::chooseMove(self->m_board, cur);
             if (mv.first == -1) self->m_board.pass();
@@ -391,8 +695,9 @@ void BoardWidget::doAIMove(int difficulty)
                 QString err; bool ok = self->m_board.play(mv.first, mv.second, &err); Q_UNUSED(ok);
             }
             emit self->stateChanged();
-            self->update();
+            self->updateMoveRegion(prevLast);
         }
+        if (perfStart >= 0) PerfMonitor::record(PerfMonitor::AiMove, perfStart);
     });
 }
 
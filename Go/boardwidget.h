@@ -4,9 +4,13 @@
 #include <QWidget>
 #include <QPoint>
 #include <QVector>
+#include <QList>
+#include <QPixmap>
+#include <QImage>
 #include "goban.h"
 
 class NetworkManager;
+class QJsonObject;
 
 class BoardWidget : public QWidget
 {
@@ -31,6 +35,8 @@ public:
     // 网络
     void setNetworkManager(NetworkManager *mgr);
     void setNetworkModeEnabled(bool enabled);
+    // 本局所在的房间; 带有其它 room_id 的消息 (观战转发) 会被忽略
+    void setRoomId(const QString &roomId) { m_roomId = roomId; }
     bool isNetworkMode() const;
 
     // 本地玩家颜色管理
@@ -43,13 +49,25 @@ public:
 
     // 网络/本地落子辅助
     void applyRemoteMove(int i, int j);
+    // 应用对方发来的增量 (落子/虚着 + 序号 + 校验哈希); 序号跳变或校验失败时请求全量同步
+    void applyRemoteDelta(const QJsonObject &delta);
+    // 当前局面序号: 每一手 (含虚着) 加一, 新局归零
+    quint32 sequence() const { return m_seq; }
     void playLocalMove(int i, int j);
 
     // AI行为
     void doAIMove(int difficulty);
 
+    // 回放: 显示给定盘面 (格式同 Goban::serialize) 代替当前对局, 只重绘与上一帧不同的交叉点
+    void showReplayPosition(const std::string &board, const std::pair<int,int> &lastMove);
+    // 退出回放, 恢复显示当前对局
+    void exitReplay();
+    bool isReplaying() const { return m_replaying; }
+
 public slots:
-    void displayAnalysis(const QVector<double>& ownershipMap);
+    // 显示分析结果: 所有权图, 黑方领先目数, 推荐点 (x=列, y=行; (-1,-1) 表示无)
+    void displayAnalysis(const QVector<double>& ownershipMap, double scoreLead = 0.0,
+                         const QPoint &bestMove = QPoint(-1, -1));
     void clearAnalysis();
 
 signals:
@@ -58,6 +76,7 @@ signals:
 
 protected:
     void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
     void mouseReleaseEvent(QMouseEvent *event) override;
 
 private:
@@ -71,6 +90,52 @@ private:
     bool m_networkMode = false;
     int m_localColor = 0; // 0 = 未设置, 1 = 黑棋, 2 = 白棋
     QVector<double> m_ownershipMap;
+    // 所有权图的 NxN 纹理 (每个交叉点一个像素), 绘制时整体缩放到棋盘上
+    QImage m_ownershipImage;
+    double m_scoreLead = 0.0;
+    QPoint m_bestMove = QPoint(-1, -1);
+
+    // 回放状态: 为 true 时绘制 m_replayBoard 而非 m_board, 且不接受点击落子
+    bool m_replaying = false;
+    std::string m_replayBoard;
+    std::pair<int,int> m_replayLastMove{-1, -1};
+    // 当前显示的盘面 (对局或回放)
+    int displayedStone(int i, int j) const;
+
+    // 分层绘制: 背景/网格/星位缓存为位图, 仅在尺寸或设备像素比变化时重建
+    QPixmap m_boardLayer;
+    int m_boardLeft = 0;
+    int m_boardTop = 0;
+    // 根据当前尺寸计算格距与棋盘左上角
+    void updateLayout();
+    void rebuildBoardLayer();
+    QPoint pointCenter(int i, int j) const { return QPoint(m_boardLeft + j*m_gridSize, m_boardTop + i*m_gridSize); }
+    // 一个交叉点的绘制范围 (棋子、标记与所有权方块)
+    QRect cellRect(int i, int j) const;
+    // 落子/虚着后只重绘受影响的交叉点: 新落子, 被提的子, 以及原最后一手标记
+    void updateMoveRegion(const std::pair<int,int> &prevLastMove);
+    // 加载盘面后只重绘内容发生变化的交叉点
+    void updateChangedPoints(const std::string &before);
+    // 将 m_ownershipMap 写入 m_ownershipImage (尺寸不变时原地更新)
+    void updateOwnershipImage();
+
+    // 增量/全量同步
+    quint32 m_seq = 0;
+    bool m_resyncPending = false;
+    QString m_roomId;
+    // 本地落子先行生效, 等待服务端 move_ack 确认; 被拒绝时恢复到落子前的盘面
+    struct PendingMove {
+        quint32 seq;
+        Goban before;   // 落子前的盘面, 用于回滚
+        quint64 hash;   // 落子后的局面哈希, 与确认中的权威哈希比对
+    };
+    QList<PendingMove> m_pendingMoves;
+    void onMoveAck(const QJsonObject &ack);
+    // 对方在 seq 之上继续落子, 说明 seq 及之前的本地落子已被接受
+    void confirmPendingUpTo(quint32 seq);
+    void sendDelta();
+    void sendSnapshot();
+    void requestResync();
 
     void tryPlay(int i, int j, bool sendNetwork=true);
     void maybeAIMove();
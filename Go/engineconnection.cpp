@@ -0,0 +1,436 @@
+#include "engineconnection.h"
+
+#include <QDebug>
+#include <QJsonDocument>
+#include <QJsonParseError>
+#include <QJsonArray>
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTimer>
+#include <QStringList>
+
+namespace {
+// 等待模型加载完成的上限; 大模型在 CPU 上加载较慢
+const int kDefaultStartupTimeoutMs = 60000;
+}
+
+EngineConnection::EngineConnection(QObject *parent)
+    : QObject(parent)
+{
+    m_clock.start();
+    m_startupTimer = new QTimer(this);
+    m_startupTimer->setSingleShot(true);
+    connect(m_startupTimer, &QTimer::timeout, this, &EngineConnection::onStartupTimeout);
+}
+
+EngineConnection::~EngineConnection()
+{
+    stop();
+}
+
+bool EngineConnection::start(const QString &program, const QStringList &arguments, const QString &workingDir)
+{
+    stop();
+
+    m_process = new QProcess(this);
+    m_process->setProcessChannelMode(QProcess::MergedChannels);
+    m_process->setWorkingDirectory(workingDir);
+    connect(m_process, &QProcess::readyReadStandardOutput, this, &EngineConnection::onReadyRead);
+    connect(m_process, &QProcess::errorOccurred, this, &EngineConnection::onProcessError);
+    connect(m_process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+            this, &EngineConnection::onProcessFinished);
+
+    // 异步启动: 不等待进程启动和模型加载, 在此之前的请求先缓存在 m_pendingWrites
+    m_ready = false;
+    bool ok = false;
+    int timeoutMs = qEnvironmentVariableIntValue("GOQT_ENGINE_STARTUP_MS", &ok);
+    m_startupTimer->start(ok && timeoutMs > 0 ? timeoutMs : kDefaultStartupTimeoutMs);
+    m_process->start(program, arguments);
+    qDebug() << "[Engine] 正在启动:" << program << arguments.join(" ");
+    return true;
+}
+
+void EngineConnection::stop()
+{
+    if (m_process) {
+        QProcess *proc = m_process;
+        m_process = nullptr;
+        disconnect(proc, nullptr, this, nullptr);
+        if (proc->state() == QProcess::NotRunning) {
+            proc->deleteLater();
+        } else {
+            // 异步退出: 先请求 quit, 超时后强制结束; 进程对象交给应用对象托管, 结束后自行释放
+            proc->setParent(QCoreApplication::instance());
+            connect(proc, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+                    proc, &QObject::deleteLater);
+            QTimer::singleShot(1000, proc, [proc]() { proc->kill(); });
+            if (proc->state() == QProcess::Running) {
+                proc->write("quit\n");
+                proc->closeWriteChannel();
+            } else {
+                proc->kill();
+            }
+        }
+    }
+    m_startupTimer->stop();
+    m_ready = false;
+    m_pendingWrites.clear();
+    m_lines.clear();
+    m_gtpActive = false;
+    m_gtpPayload.clear();
+    m_gtpInFlight.clear();
+    m_analysisInFlight.clear();
+    m_gtpTiming.clear();
+    m_analysisTiming.clear();
+    if (!m_latency.isEmpty() && qEnvironmentVariableIsSet("GOQT_ENGINE_STATS")) {
+        qDebug().noquote() << "[Engine] 延迟统计:\n" + latencyReport();
+    }
+}
+
+bool EngineConnection::isRunning() const
+{
+    return m_process && m_process->state() != QProcess::NotRunning;
+}
+
+void EngineConnection::writeLine(const QByteArray &line)
+{
+    if (m_ready) m_process->write(line);
+    else m_pendingWrites.append(line);
+}
+
+void EngineConnection::markReady()
+{
+    if (m_ready || !m_process) return;
+    m_startupTimer->stop();
+    m_ready = true;
+    qDebug() << "[Engine] 引擎已就绪, 发送缓存的请求:" << m_pendingWrites.size();
+    for (const QByteArray &line : qAsConst(m_pendingWrites)) m_process->write(line);
+    m_pendingWrites.clear();
+
+    // 缓存的命令此刻才真正写入管道
+    const qint64 now = nowUs();
+    for (CommandTiming &t : m_gtpTiming) if (t.sent < 0) t.sent = now;
+    for (CommandTiming &t : m_analysisTiming) if (t.sent < 0) t.sent = now;
+    emit ready();
+}
+
+int EngineConnection::sendGtp(const QByteArray &command)
+{
+    int id = m_nextGtpId++;
+    if (!isRunning()) return -1;
+    QByteArray line = QByteArray::number(id);
+    line.append(' ');
+    line.append(command);
+    line.append('\n');
+    writeLine(line);
+    m_gtpInFlight.enqueue(id);
+
+    CommandTiming t;
+    int space = command.indexOf(' ');
+    t.command = space < 0 ? command : command.left(space);
+    t.queued = nowUs();
+    if (m_ready) t.sent = t.queued;
+    m_gtpTiming.insert(id, t);
+    return id;
+}
+
+QString EngineConnection::sendAnalysis(QJsonObject query)
+{
+    QString id = query.value("id").toString();
+    if (id.isEmpty()) {
+        id = QStringLiteral("q%1").arg(m_nextAnalysisId++);
+        query["id"] = id;
+    }
+    if (!isRunning()) return QString();
+
+    // 一个请求对应的最终响应条数: analyzeTurns 每个回合一条, 否则一条
+    int expected = 1;
+    if (query.contains("analyzeTurns")) expected = qMax(1, query.value("analyzeTurns").toArray().size());
+    m_analysisInFlight.insert(id, expected);
+
+    CommandTiming t;
+    t.command = "analysis";
+    t.queued = nowUs();
+    if (m_ready) t.sent = t.queued;
+    m_analysisTiming.insert(id, t);
+
+    QByteArray line = QJsonDocument(query).toJson(QJsonDocument::Compact);
+    line.append('\n');
+    writeLine(line);
+    return id;
+}
+
+void EngineConnection::terminateAnalysis(const QString &id)
+{
+    m_analysisTiming.remove(id);
+    if (!m_analysisInFlight.remove(id) || !isRunning()) return;
+    QJsonObject action;
+    action["id"] = QStringLiteral("t%1").arg(m_nextAnalysisId++);
+    action["action"] = "terminate";
+    action["terminateId"] = id;
+    QByteArray line = QJsonDocument(action).toJson(QJsonDocument::Compact);
+    line.append('\n');
+    writeLine(line);
+}
+
+void EngineConnection::onReadyRead()
+{
+    if (!m_process) return;
+    m_lines.readFrom(m_process);
+    m_readAt = nowUs();
+    QByteArray line;
+    while (m_lines.nextLine(&line)) {
+        handleLine(line);
+    }
+}
+
+void EngineConnection::handleLine(const QByteArray &line)
+{
+    // 跳过行首空白后按首字符分流, 避免对每一行都尝试 JSON 解析
+    int k = 0;
+    while (k < line.size() && (line[k] == ' ' || line[k] == '\t')) ++k;
+    char c = (k < line.size()) ? line[k] : '\0';
+
+    if (c == '{') {
+        handleJsonLine(line);
+    } else if (c == '=' || c == '?' || c == '\0') {
+        handleGtpLine(line);
+    } else if (m_gtpActive) {
+        // 多行 GTP 响应的后续行
+        handleGtpLine(line);
+    } else {
+        // KataGo 加载完模型后会打印就绪提示 (GTP 与分析模式各一种)
+        if (!m_ready && (line.contains("GTP ready") || line.contains("ready to begin handling requests"))) {
+            markReady();
+            return;
+        }
+        qDebug() << "[Engine]" << line;
+    }
+}
+
+void EngineConnection::handleGtpLine(const QByteArray &line)
+{
+    if (line.trimmed().isEmpty()) {
+        // 空行结束一条 GTP 响应
+        if (!m_gtpActive) return;
+        // 优先使用引擎回显的编号, 未回显时按先进先出取队首
+        int id = m_gtpRespId;
+        if (id >= 0) m_gtpInFlight.removeOne(id);
+        else if (!m_gtpInFlight.isEmpty()) id = m_gtpInFlight.dequeue();
+        QString payload = m_gtpPayload;
+        bool ok = m_gtpOk;
+        m_gtpActive = false;
+        m_gtpPayload.clear();
+        m_gtpRespId = -1;
+        auto t = m_gtpTiming.find(id);
+        if (t != m_gtpTiming.end()) {
+            finishTiming(t.value());
+            m_gtpTiming.erase(t);
+        }
+        emit gtpResponse(id, ok, payload);
+        return;
+    }
+
+    if (!m_gtpActive && (line.startsWith('=') || line.startsWith('?'))) {
+        // 首行: "=<id> <内容>" 或 "?<id> <错误>"
+        m_gtpActive = true;
+        m_gtpOk = line.startsWith('=');
+        int k = 1;
+        while (k < line.size() && line[k] >= '0' && line[k] <= '9') ++k;
+        bool okId = false;
+        int rid = line.mid(1, k - 1).toInt(&okId);
+        m_gtpRespId = okId ? rid : -1;
+        m_gtpPayload = QString::fromLatin1(line.mid(k)).trimmed();
+
+        int timedId = m_gtpRespId >= 0 ? m_gtpRespId : (m_gtpInFlight.isEmpty() ? -1 : m_gtpInFlight.head());
+        auto t = m_gtpTiming.find(timedId);
+        if (t != m_gtpTiming.end() && t->firstByte < 0) t->firstByte = m_readAt;
+        return;
+    }
+
+    if (!m_gtpActive) return;
+    m_gtpPayload += QLatin1Char('\n') + QString::fromLatin1(line).trimmed();
+}
+
+void EngineConnection::handleJsonLine(const QByteArray &line)
+{
+    QJsonParseError error;
+    QJsonDocument doc = QJsonDocument::fromJson(line, &error);
+    if (error.error != QJsonParseError::NoError || !doc.isObject()) {
+        qDebug() << "[Engine] 无法解析的 JSON 行:" << error.errorString();
+        return;
+    }
+    QJsonObject obj = doc.object();
+    QString id = obj.value("id").toString();
+
+    if (obj.contains("error")) {
+        m_analysisInFlight.remove(id);
+        m_analysisTiming.remove(id);
+        emit analysisError(id, obj.value("error").toString());
+        return;
+    }
+    if (obj.contains("warning")) {
+        qDebug() << "[Engine] 分析警告:" << obj.value("warning").toString();
+        return;
+    }
+
+    // 搜索途中的中间结果不计入完成条数
+    bool final = !obj.value("isDuringSearch").toBool(false);
+    auto timing = m_analysisTiming.find(id);
+    if (timing != m_analysisTiming.end() && timing->firstByte < 0) timing->firstByte = m_readAt;
+    auto it = m_analysisInFlight.find(id);
+    if (final && it != m_analysisInFlight.end()) {
+        if (--it.value() <= 0) {
+            m_analysisInFlight.erase(it);
+            if (timing != m_analysisTiming.end()) {
+                finishTiming(timing.value());
+                m_analysisTiming.erase(timing);
+            }
+        }
+    }
+    emit analysisResponse(id, obj);
+}
+
+void EngineConnection::onProcessError(QProcess::ProcessError error)
+{
+    QString msg = m_process ? m_process->errorString() : QString();
+    qDebug() << "[Engine] 进程错误:" << error << msg;
+    if (error == QProcess::FailedToStart) {
+        m_startupTimer->stop();
+        m_ready = false;
+        m_pendingWrites.clear();
+        failOutstanding(tr("引擎启动失败"));
+    }
+    emit processError(msg);
+}
+
+void EngineConnection::onProcessFinished(int exitCode, QProcess::ExitStatus status)
+{
+    qDebug() << "[Engine] 进程已退出:" << exitCode << status;
+    m_startupTimer->stop();
+    m_ready = false;
+    m_pendingWrites.clear();
+    failOutstanding(tr("引擎进程已退出"));
+    emit processError(tr("引擎进程已退出"));
+}
+
+void EngineConnection::onStartupTimeout()
+{
+    if (m_ready || !m_process) return;
+    qDebug() << "[Engine] 等待引擎就绪超时, 放弃启动";
+    QProcess *stalled = m_process;
+    failOutstanding(tr("引擎启动超时"));
+    // 处理函数中可能已重新启动引擎, 只停止超时的这个进程
+    if (m_process == stalled) stop();
+    emit processError(tr("引擎启动超时"));
+}
+
+void EngineConnection::failOutstanding(const QString &reason)
+{
+    // 先清空再通知: 处理函数中可能重新启动引擎并发出新请求
+    const QList<int> gtpIds = m_gtpInFlight;
+    const QList<QString> analysisIds = m_analysisInFlight.keys();
+    m_gtpInFlight.clear();
+    m_analysisInFlight.clear();
+    m_gtpTiming.clear();
+    m_analysisTiming.clear();
+    m_gtpActive = false;
+    m_gtpPayload.clear();
+    m_gtpRespId = -1;
+    for (int id : gtpIds) emit gtpResponse(id, false, reason);
+    for (const QString &id : analysisIds) emit analysisError(id, reason);
+}
+
+void EngineConnection::finishTiming(const CommandTiming &t)
+{
+    const qint64 sent = t.sent < 0 ? t.queued : t.sent;
+    const qint64 done = m_readAt;
+    const qint64 queueUs = sent - t.queued;
+    const qint64 firstByteUs = (t.firstByte < 0 ? done : t.firstByte) - sent;
+    const qint64 totalUs = done - sent;
+
+    QVector<LatencyHistogram> &h = m_latency[t.command];
+    if (h.isEmpty()) h.resize(PhaseCount);
+    h[QueueWait].record(queueUs);
+    h[FirstByte].record(firstByteUs);
+    h[Total].record(totalUs);
+    emit commandTimed(t.command, queueUs, firstByteUs, totalUs);
+}
+
+const LatencyHistogram *EngineConnection::histogram(const QByteArray &command, Phase phase) const
+{
+    auto it = m_latency.constFind(command);
+    if (it == m_latency.constEnd() || phase < 0 || phase >= PhaseCount) return nullptr;
+    return &it.value()[phase];
+}
+
+QString EngineConnection::latencyReport() const
+{
+    static const char *const phaseNames[PhaseCount] = { "排队", "首字节", "完成" };
+    QStringList lines;
+    for (auto it = m_latency.constBegin(); it != m_latency.constEnd(); ++it) {
+        for (int p = 0; p < PhaseCount; ++p) {
+            lines << QString("%1 %2: %3")
+                     .arg(QString::fromLatin1(it.key()), -12)
+                     .arg(QString::fromUtf8(phaseNames[p]))
+                     .arg(it.value()[p].summary());
+        }
+    }
+    return lines.join('\n');
+}
+
+bool EngineConnection::locateKataGo(QString *exePath, QString *workingDir)
+{
+    // 环境变量可指定其它兼容的引擎 (如 mock_engine), 用于在没有 KataGo 的机器上测试
+    QString overrideExe = qEnvironmentVariable("GOQT_KATAGO_EXE");
+    if (!overrideExe.isEmpty()) {
+        if (!QFile::exists(overrideExe)) {
+            qDebug() << "--- 致命错误: GOQT_KATAGO_EXE 指定的引擎不存在:" << overrideExe;
+            return false;
+        }
+        if (exePath) *exePath = overrideExe;
+        if (workingDir) *workingDir = QFileInfo(overrideExe).absolutePath();
+        return true;
+    }
+    QString kataGoDir = QCoreApplication::applicationDirPath() + "/katago/";
+    if (!QDir(kataGoDir).exists()) {
+        qDebug() << "--- 致命错误: KataGo 目录未找到于:" << kataGoDir;
+        return false;
+    }
+    QString exe = kataGoDir + "katago.exe";
+    if (!QFile::exists(exe)) {
+        qDebug() << "--- 致命错误: katago.exe 未找到于:" << exe;
+        return false;
+    }
+    if (exePath) *exePath = exe;
+    if (workingDir) *workingDir = kataGoDir;
+    return true;
+}
+
+QString EngineConnection::gtpVertex(int i, int j, int boardSize)
+{
+    char colChar = char('A' + j);
+    if (colChar >= 'I') colChar++;
+    int row = boardSize - i;
+    return QString(QLatin1Char(colChar)) + QString::number(row);
+}
+
+bool EngineConnection::parseGtpVertex(const QString &vertex, int boardSize, int *i, int *j)
+{
+    QString v = vertex.trimmed().toUpper();
+    if (v.length() < 2 || v == "PASS" || v == "RESIGN") return false;
+    char c = v[0].toLatin1();
+    if (c < 'A' || c > 'Z' || c == 'I') return false;
+    int col = c - 'A';
+    if (c > 'I') col--;
+    bool ok = false;
+    int row = v.mid(1).toInt(&ok);
+    if (!ok) return false;
+    int r = boardSize - row;
+    if (r < 0 || r >= boardSize || col < 0 || col >= boardSize) return false;
+    if (i) *i = r;
+    if (j) *j = col;
+    return true;
+}
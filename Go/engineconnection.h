@@ -0,0 +1,140 @@
+#ifndef ENGINECONNECTION_H
+#define ENGINECONNECTION_H
+
+#include <QObject>
+#include <QProcess>
+#include <QQueue>
+#include <QHash>
+#include <QJsonObject>
+#include <QElapsedTimer>
+#include <QMap>
+#include <QVector>
+#include "lineringbuffer.h"
+#include "latencyhistogram.h"
+
+class QTimer;
+
+/*
+ EngineConnection: 与 KataGo 子进程之间的管道通信
+  - GTP 命令自动编号 ("<id> genmove B"), 响应 "=<id> ..." 按编号匹配
+  - 分析请求自动填写 "id" 字段, 多个请求可同时在途, 响应按 id 分发
+  - 输出按行切分后按首字符直接分流: '{' 为分析 JSON, '='/'?' 为 GTP 响应, 其余为日志
+  - 启动与停止均为异步, 不阻塞界面线程; 模型加载完成前的请求先缓存, 就绪后按序发出
+  - 启动超时 (默认 60 秒, GOQT_ENGINE_STARTUP_MS 可调) 或进程退出时, 所有在途请求以错误响应结束
+  - 每条命令记录 提交/写入/首字节/完成 时间, 按命令名分别统计延迟直方图
+*/
+class EngineConnection : public QObject
+{
+    Q_OBJECT
+public:
+    explicit EngineConnection(QObject *parent = nullptr);
+    ~EngineConnection();
+
+    // 异步启动引擎进程, 立即返回; 模型加载完成后发出 ready()
+    bool start(const QString &program, const QStringList &arguments, const QString &workingDir);
+    // 异步停止引擎进程 (发送 quit, 超时后强制结束)
+    void stop();
+    // 进程正在启动或运行
+    bool isRunning() const;
+    // 模型已加载, 可以立即处理请求
+    bool isReady() const { return m_ready; }
+
+    // 发送一条 GTP 命令 (不含编号和换行), 返回分配的编号
+    int sendGtp(const QByteArray &command);
+    // 发送一条分析请求; 若 query 未带 "id" 则自动分配, 返回最终使用的 id
+    QString sendAnalysis(QJsonObject query);
+    // 终止一条在途的分析请求; 之后该 id 不再计入在途数量
+    void terminateAnalysis(const QString &id);
+
+    // 在途请求数量
+    int pendingGtpCount() const { return m_gtpInFlight.size(); }
+    int pendingAnalysisCount() const { return m_analysisInFlight.size(); }
+    bool isAnalysisPending(const QString &id) const { return m_analysisInFlight.contains(id); }
+
+    // 延迟统计的阶段 (均为微秒)
+    enum Phase {
+        QueueWait = 0, // 提交 -> 写入管道 (等待模型加载)
+        FirstByte,     // 写入 -> 收到第一行响应
+        Total,         // 写入 -> 响应完成
+        PhaseCount
+    };
+    // 某条命令 (GTP 命令名, 或 "analysis") 在某阶段的直方图; 没有记录时返回 nullptr
+    const LatencyHistogram *histogram(const QByteArray &command, Phase phase) const;
+    // 所有命令的延迟摘要, 每个命令/阶段一行
+    QString latencyReport() const;
+    void resetLatencyStats() { m_latency.clear(); }
+
+    // 查找应用目录下 katago/ 中的可执行文件 (可用 GOQT_KATAGO_EXE 覆盖); 找不到时返回 false
+    static bool locateKataGo(QString *exePath, QString *workingDir);
+
+    // 坐标换算: 棋盘 (i 行, j 列) <-> GTP 坐标 (如 "D4", 跳过字母 I)
+    static QString gtpVertex(int i, int j, int boardSize);
+    // 解析 GTP 坐标; "PASS" 等非落子返回 false
+    static bool parseGtpVertex(const QString &vertex, int boardSize, int *i, int *j);
+
+signals:
+    // 引擎完成模型加载
+    void ready();
+    // GTP 响应; ok=false 表示 '?' 错误响应, payload 为去掉 "=<id> " 后的内容
+    void gtpResponse(int id, bool ok, const QString &payload);
+    // 分析响应 (一个请求可能对应多条, 如 analyzeTurns)
+    void analysisResponse(const QString &id, const QJsonObject &response);
+    // 分析请求报错
+    void analysisError(const QString &id, const QString &message);
+    void processError(const QString &message);
+    // 一条命令完成 (GTP 响应结束或分析请求的最后一条结果), 各阶段耗时单位为微秒
+    void commandTimed(const QByteArray &command, qint64 queueUs, qint64 firstByteUs, qint64 totalUs);
+
+private slots:
+    void onReadyRead();
+    void onProcessError(QProcess::ProcessError error);
+    void onProcessFinished(int exitCode, QProcess::ExitStatus status);
+
+private:
+    // 一条在途命令的时间戳 (相对 m_clock, 微秒)
+    struct CommandTiming {
+        QByteArray command;
+        qint64 queued = 0;
+        qint64 sent = -1;
+        qint64 firstByte = -1;
+    };
+    qint64 nowUs() const { return m_clock.nsecsElapsed() / 1000; }
+    void finishTiming(const CommandTiming &t);
+
+    // 就绪前缓存, 就绪后直接写入进程
+    void writeLine(const QByteArray &line);
+    void markReady();
+    void handleLine(const QByteArray &line);
+    void handleGtpLine(const QByteArray &line);
+    void handleJsonLine(const QByteArray &line);
+    // 引擎不可用: 所有在途请求以错误结束 (GTP 发 gtpResponse(ok=false), 分析发 analysisError)
+    void failOutstanding(const QString &reason);
+    void onStartupTimeout();
+
+    QProcess *m_process = nullptr;
+    QTimer *m_startupTimer = nullptr;
+    LineRingBuffer m_lines;
+    bool m_ready = false;
+    QList<QByteArray> m_pendingWrites;
+
+    int m_nextGtpId = 1;
+    int m_nextAnalysisId = 1;
+    // GTP 按先进先出返回, 队首即当前等待响应的命令
+    QQueue<int> m_gtpInFlight;
+    // 正在接收的 GTP 响应 (空行结束)
+    bool m_gtpActive = false;
+    QString m_gtpPayload;
+    bool m_gtpOk = true;
+    int m_gtpRespId = -1;
+    // 分析请求 id -> 尚未收到的响应条数
+    QHash<QString, int> m_analysisInFlight;
+
+    // 延迟统计
+    QElapsedTimer m_clock;
+    qint64 m_readAt = 0; // 本批输出从管道读出的时间
+    QHash<int, CommandTiming> m_gtpTiming;
+    QHash<QString, CommandTiming> m_analysisTiming;
+    QMap<QByteArray, QVector<LatencyHistogram>> m_latency; // 命令名 -> 各阶段直方图
+};
+
+#endif // ENGINECONNECTION_H
@@ -0,0 +1,143 @@
+#include "gamereview.h"
+#include "goban.h"
+#include "analysisservice.h"
+#include "analysiscache.h"
+#include "engineconnection.h"
+
+#include <QJsonArray>
+#include <QDebug>
+
+GameReview::GameReview(QObject *parent)
+    : QObject(parent)
+{
+    AnalysisService *service = AnalysisService::instance();
+    connect(service, &AnalysisService::resultReady, this, &GameReview::onResult);
+    connect(service, &AnalysisService::queryFailed, this, &GameReview::onQueryFailed);
+}
+
+GameReview::~GameReview()
+{
+    cancel();
+}
+
+bool GameReview::start(const Goban &goban)
+{
+    cancel();
+    if (!AnalysisService::isAvailable()) return false;
+
+    m_boardSize = goban.size();
+    const auto &history = goban.getMoveHistory();
+    const int turns = int(history.size()) + 1;
+    m_turns = QVector<Turn>(turns);
+    m_cacheKeys = QVector<quint64>(turns, 0);
+    m_analyzed = 0;
+
+    // 重放落子历史, 得到每一手之后的局面哈希, 同时构建着法列表
+    Goban replay(m_boardSize);
+    QJsonArray movesArray;
+    m_cacheKeys[0] = AnalysisCache::makeKey(replay.hash(), m_boardSize, 7.5, "tromp-taylor", m_maxVisits);
+    for (int t = 0; t < int(history.size()); ++t) {
+        const auto &pos = history[t].first;
+        int color = history[t].second;
+        replay.setCurrentPlayer(color);
+        replay.play(pos.first, pos.second);
+        m_cacheKeys[t + 1] = AnalysisCache::makeKey(replay.hash(), m_boardSize, 7.5, "tromp-taylor", m_maxVisits);
+
+        QJsonArray moveJson;
+        moveJson.append(color == 1 ? "B" : "W");
+        moveJson.append(EngineConnection::gtpVertex(pos.first, pos.second, m_boardSize));
+        movesArray.append(moveJson);
+    }
+
+    // 已缓存的局面直接填入, 只请求剩余的手数
+    AnalysisService *service = AnalysisService::instance();
+    QJsonArray analyzeTurns;
+    for (int t = 0; t < turns; ++t) {
+        QJsonObject cached;
+        if (service->cachedResult(m_cacheKeys[t], &cached)) storeTurn(t, cached);
+        else analyzeTurns.append(t);
+    }
+
+    if (analyzeTurns.isEmpty()) {
+        emit progress(m_analyzed, turns);
+        emit finished();
+        return true;
+    }
+
+    QJsonObject request;
+    request["moves"] = movesArray;
+    request["rules"] = "tromp-taylor";
+    request["komi"] = 7.5;
+    request["boardXSize"] = m_boardSize;
+    request["boardYSize"] = m_boardSize;
+    request["maxVisits"] = m_maxVisits;
+    request["includeOwnership"] = true;
+    request["analyzeTurns"] = analyzeTurns;
+
+    m_requestId = service->submit(request, AnalysisService::Background);
+    qDebug() << "[GameReview] 复盘请求:" << m_requestId << " 局面数:" << analyzeTurns.size() << "/" << turns;
+    if (m_requestId.isEmpty()) return false;
+    emit progress(m_analyzed, turns);
+    return true;
+}
+
+void GameReview::cancel()
+{
+    if (m_requestId.isEmpty()) return;
+    AnalysisService::instance()->cancel(m_requestId);
+    m_requestId.clear();
+}
+
+void GameReview::storeTurn(int index, const QJsonObject &response)
+{
+    Turn &turn = m_turns[index];
+    QJsonObject rootInfo = response.value("rootInfo").toObject();
+    turn.visits = rootInfo.value("visits").toInt();
+    turn.winrate = rootInfo.value("winrate").toDouble();
+    turn.scoreLead = rootInfo.value("scoreLead").toDouble();
+
+    const QJsonArray moveInfos = response.value("moveInfos").toArray();
+    for (const auto &mv : moveInfos) {
+        QJsonObject info = mv.toObject();
+        if (info.value("order").toInt(-1) != 0) continue;
+        int i = -1, j = -1;
+        if (EngineConnection::parseGtpVertex(info.value("move").toString(), m_boardSize, &i, &j)) {
+            turn.bestMove = QPoint(j, i);
+        }
+        break;
+    }
+
+    const QJsonArray own = response.value("ownership").toArray();
+    turn.ownership.clear();
+    turn.ownership.reserve(own.size());
+    for (const auto &v : own) turn.ownership.append(v.toDouble());
+
+    if (!turn.valid) ++m_analyzed;
+    turn.valid = true;
+    emit turnAnalyzed(index);
+}
+
+void GameReview::onResult(const QString &id, const QJsonObject &response)
+{
+    if (id != m_requestId || response.value("isDuringSearch").toBool(false)) return;
+
+    int index = response.value("turnNumber").toInt(-1);
+    if (index < 0 || index >= m_turns.size()) return;
+    if (response.contains("ownership")) {
+        AnalysisService::instance()->storeResult(m_cacheKeys[index], m_boardSize, response);
+    }
+    storeTurn(index, response);
+    emit progress(m_analyzed, m_turns.size());
+
+    if (m_analyzed == m_turns.size()) {
+        m_requestId.clear();
+        emit finished();
+    }
+}
+
+void GameReview::onQueryFailed(const QString &id, const QString &message)
+{
+    if (id != m_requestId) return;
+    m_requestId.clear();
+    emit failed(message);
+}
@@ -0,0 +1,70 @@
+#ifndef GAMEREVIEW_H
+#define GAMEREVIEW_H
+
+#include <QObject>
+#include <QVector>
+#include <QPoint>
+#include <QJsonObject>
+
+class Goban;
+
+/*
+ GameReview: 整局复盘
+  - 整局只发送一条分析请求, 用 analyzeTurns 覆盖第 0 手到最后一手的所有局面, 避免逐手重发着法列表
+  - 各手结果按 turnNumber 陆续返回, 存入按手数索引的数组, 拖动复盘进度时直接读取
+  - 已在缓存中的局面不再请求引擎
+  - 以后台优先级提交, 不阻塞用户的形势判断
+*/
+class GameReview : public QObject
+{
+    Q_OBJECT
+public:
+    // 某一手之后局面的分析结果
+    struct Turn {
+        bool valid = false;
+        int visits = 0;
+        double winrate = 0.0;    // 黑方胜率
+        double scoreLead = 0.0;  // 黑方领先目数
+        QPoint bestMove = QPoint(-1, -1); // x=列, y=行
+        QVector<double> ownership;
+    };
+
+    explicit GameReview(QObject *parent = nullptr);
+    ~GameReview();
+
+    // 以 goban 的落子历史开始复盘 (会取消上一次未完成的复盘); 失败返回 false
+    bool start(const Goban &goban);
+    void cancel();
+    bool isRunning() const { return !m_requestId.isEmpty(); }
+
+    void setMaxVisits(int maxVisits) { m_maxVisits = qMax(1, maxVisits); }
+
+    // 局面数 = 手数 + 1 (第 0 手为空棋盘)
+    int turnCount() const { return m_turns.size(); }
+    int analyzedCount() const { return m_analyzed; }
+    const Turn &turn(int index) const { return m_turns.at(index); }
+    bool hasTurn(int index) const { return index >= 0 && index < m_turns.size() && m_turns.at(index).valid; }
+
+signals:
+    // 某一手的结果已就绪
+    void turnAnalyzed(int index);
+    void progress(int analyzed, int total);
+    void finished();
+    void failed(const QString &message);
+
+private slots:
+    void onResult(const QString &id, const QJsonObject &response);
+    void onQueryFailed(const QString &id, const QString &message);
+
+private:
+    void storeTurn(int index, const QJsonObject &response);
+
+    QString m_requestId;
+    int m_boardSize = 19;
+    int m_maxVisits = 100;
+    int m_analyzed = 0;
+    QVector<Turn> m_turns;
+    QVector<quint64> m_cacheKeys; // 每手局面的缓存键
+};
+
+#endif // GAMEREVIEW_H
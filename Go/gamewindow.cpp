@@ -1,11 +1,18 @@
 #include "gamewindow.h"
 #include "networkmanager.h"
 #include "boardwidget.h"
+#include "analysisservice.h"
+#include "engineconnection.h"
+#include "gamereview.h"
+#include "perfmonitor.h"
+#include "perfoverlay.h"
 
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QLabel>
 #include <QPushButton>
+#include <QSlider>
+#include <QSignalBlocker>
 #include <QMessageBox>
 #include <QJsonDocument>
 #include <QTimer>
@@ -32,9 +39,14 @@ GameWindow::GameWindow(NetworkManager *net, const QJsonObject &you, const QJsonO
     m_oppLabel = new QLabel(this);
     main->addWidget(m_youLabel);
     main->addWidget(m_oppLabel);
+    m_netLabel = new QLabel(this);
+    m_netLabel->setVisible(false);
+    main->addWidget(m_netLabel);
 
     // 创建棋盘并立即绑定网络管理器
     m_board = new BoardWidget(this);
+    m_board->setRoomId(m_room.value("room_id").toString());
+    if (PerfMonitor::isEnabled()) new PerfOverlay(m_board);
     if (m_net) m_board->setNetworkManager(m_net);
     m_board->setNetworkModeEnabled(false);
     main->addWidget(m_board, 1);
@@ -44,6 +56,7 @@ GameWindow::GameWindow(NetworkManager *net, const QJsonObject &you, const QJsonO
     m_readyBtn = new QPushButton(tr("准备"), this);
     m_passBtn = new QPushButton(tr("过"), this);
     m_judgeBtn = new QPushButton(tr("形势判断"), this);
+    m_reviewBtn = new QPushButton(tr("复盘"), this);
     m_requestEndBtn = new QPushButton(tr("点目"), this);
     m_resignBtn = new QPushButton(tr("认输"), this);
     m_leaveBtn = new QPushButton(tr("离开房间"), this);
@@ -53,6 +66,7 @@ GameWindow::GameWindow(NetworkManager *net, const QJsonObject &you, const QJsonO
     btns->addWidget(m_readyBtn);
     btns->addWidget(m_passBtn);
     btns->addWidget(m_judgeBtn);
+    btns->addWidget(m_reviewBtn);
     btns->addWidget(m_requestEndBtn);
     btns->addWidget(m_resignBtn);
     btns->addWidget(m_restartBtn);
@@ -61,12 +75,19 @@ GameWindow::GameWindow(NetworkManager *net, const QJsonObject &you, const QJsonO
     btns->addWidget(m_leaveBtn);
     main->addLayout(btns);
 
+    // 复盘进度条: 复盘开始后才显示
+    m_reviewSlider = new QSlider(Qt::Horizontal, this);
+    m_reviewSlider->setVisible(false);
+    main->addWidget(m_reviewSlider);
+
     connect(m_passBtn, &QPushButton::clicked, this, &GameWindow::onPassClicked);
     connect(m_requestEndBtn, &QPushButton::clicked, this, &GameWindow::onRequestEndClicked);
     connect(m_resignBtn, &QPushButton::clicked, this, &GameWindow::onResignClicked);
     connect(m_leaveBtn, &QPushButton::clicked, this, &GameWindow::onLeaveRoom);
     connect(m_readyBtn, &QPushButton::clicked, this, &GameWindow::onReadyClicked);
     connect(m_judgeBtn, &QPushButton::clicked, this, &GameWindow::onJudgeClicked);
+    connect(m_reviewBtn, &QPushButton::clicked, this, &GameWindow::onReviewClicked);
+    connect(m_reviewSlider, &QSlider::valueChanged, this, &GameWindow::onReviewSliderMoved);
     connect(m_restartBtn, &QPushButton::clicked, this, &GameWindow::onRestartClicked);
     connect(m_changeSettingsBtn, &QPushButton::clicked, this, &GameWindow::onChangeSettingsClicked);
 
@@ -99,8 +120,14 @@ GameWindow::GameWindow(NetworkManager *net, const QJsonObject &you, const QJsonO
 
     // 网络事件 (使用QueuedConnection避免重入)
     if (m_net) {
-        connect(m_net, &NetworkManager::jsonReceived, this, &GameWindow::onNetworkJsonReceived, Qt::QueuedConnection);
+        using Msg = MessageDispatcher;
+        m_net->dispatcher()->subscribe(
+            {Msg::Start, Msg::PlayerReady, Msg::EndRequest, Msg::EndConfirm, Msg::Resign,
+             Msg::OpponentDisconnected, Msg::OpponentReconnected, Msg::OpponentLeft, Msg::OpponentJoined,
+             Msg::RoomJoined, Msg::Matched, Msg::Chat, Msg::Move, Msg::Pass, Msg::Delta, Msg::MoveAck, Msg::Error},
+            this, [this](Msg::Type t, const QJsonObject &obj) { onNetworkMessage(t, obj); });
         connect(m_net, &NetworkManager::logMessage, this, &GameWindow::onLogMessage, Qt::QueuedConnection);
+        connect(m_net, &NetworkManager::statsUpdated, this, &GameWindow::updateNetworkStats);
     }
 
     // 如果房间信息中已分配颜色, 则设置本地玩家颜色
@@ -113,9 +140,11 @@ GameWindow::GameWindow(NetworkManager *net, const QJsonObject &you, const QJsonO
     // 初始化一个专门用于形势判断的AI管理器
     m_analysisMgr = new SinglePlayerManager(this);
     m_analysisMgr->attachBoard(m_board);
-    // 使用 "level 2" (高级) 启动它, 使其在后台运行 KataGo 进程
+    // 使用 "level 2" (高级) 启动它; 共享分析引擎在第一次形势判断时才异步加载, 不阻塞窗口打开
     m_analysisMgr->start(0, 2);
+    connect(m_analysisMgr, &SinglePlayerManager::analysisUpdated, this, &GameWindow::onAnalysisUpdated);
     connect(m_analysisMgr, &SinglePlayerManager::analysisReady, this, &GameWindow::onAnalysisReady);
+    connect(m_analysisMgr, &SinglePlayerManager::analysisFailed, this, &GameWindow::onAnalysisFailed);
 
     // UI 初始状态
     m_readyBtn->setEnabled(true);
@@ -153,9 +182,7 @@ GameWindow::GameWindow(NetworkManager *net, const QJsonObject &you, const QJsonO
     // 如果是单机模式
     if (m_room.contains("singleplayer") && m_room.value("singleplayer").toBool()) {
             m_isSinglePlayer = true;
-            if (m_net) {
-                disconnect(m_net, nullptr, this, nullptr); // 断开网络连接
-            }
+            detachFromNetwork(); // 断开网络连接
             m_board->setNetworkManager(nullptr);
             m_board->setNetworkModeEnabled(false);
 
@@ -205,9 +232,7 @@ GameWindow::GameWindow(NetworkManager *net, const QJsonObject &you, const QJsonO
 GameWindow::~GameWindow()
 {
     m_exiting = true;
-    if (m_net) {
-        disconnect(m_net, nullptr, this, nullptr);
-    }
+    detachFromNetwork();
     if (m_board) {
         m_board->setNetworkManager(nullptr);
     }
@@ -309,6 +334,7 @@ void GameWindow::onRestartClicked()
     m_resignBtn->setEnabled(true);
 
     // 重置棋盘
+    resetReview();
     m_board->newGame();
 
     // 重新启动AI
@@ -359,31 +385,145 @@ void GameWindow::onJudgeClicked()
 {
     // 统一使用 m_analysisMgr 进行形势判断
     if (m_analysisMgr && m_analysisMgr->isRunning()) {
-        m_infoLabel->setText(tr("正在请求AI进行形势判断..."));
+        if (AnalysisService::instance()->isReady()) {
+            m_infoLabel->setText(tr("正在请求AI进行形势判断..."));
+        } else {
+            // 请求会在引擎就绪后自动发出
+            m_infoLabel->setText(tr("正在加载分析引擎, 请稍候..."));
+        }
         m_analysisMgr->requestAnalysis();
     } else {
         QMessageBox::warning(this, tr("错误"), tr("分析引擎尚未准备好。"));
     }
 }
 
-void GameWindow::onAnalysisReady(const QJsonObject &analysisData)
+void GameWindow::onReviewClicked()
+{
+    if (!AnalysisService::isAvailable()) {
+        QMessageBox::warning(this, tr("错误"), tr("分析引擎尚未准备好。"));
+        return;
+    }
+    if (!m_review) {
+        m_review = new GameReview(this);
+        connect(m_review, &GameReview::turnAnalyzed, this, &GameWindow::onReviewTurnAnalyzed);
+        connect(m_review, &GameReview::progress, this, [this](int analyzed, int total) {
+            m_infoLabel->setText(tr("复盘分析中... (%1/%2)").arg(analyzed).arg(total));
+        });
+        connect(m_review, &GameReview::finished, this, [this]() {
+            m_infoLabel->setText(tr("复盘分析完成, 拖动进度条查看每一手"));
+        });
+        connect(m_review, &GameReview::failed, this, [this](const QString &message) {
+            m_infoLabel->setText(tr("复盘失败: %1").arg(message));
+        });
+    }
+    if (!m_review->start(m_board->goban())) {
+        QMessageBox::warning(this, tr("错误"), tr("无法开始复盘。"));
+        return;
+    }
+    m_replay.load(m_board->goban());
+    QSignalBlocker blocker(m_reviewSlider);
+    m_reviewSlider->setRange(0, m_replay.moveCount());
+    m_reviewSlider->setValue(m_replay.moveCount());
+    m_reviewSlider->setVisible(true);
+}
+
+void GameWindow::resetReview()
+{
+    // 新的一局开始后, 上一局的复盘数据与回放位置都已失效
+    if (m_review) {
+        m_review->cancel();
+        m_review->deleteLater();
+        m_review = nullptr;
+    }
+    m_replay.clear();
+    QSignalBlocker blocker(m_reviewSlider);
+    m_reviewSlider->setRange(0, 0);
+    m_reviewSlider->setVisible(false);
+    m_board->exitReplay();
+    m_board->clearAnalysis();
+}
+
+void GameWindow::onReviewTurnAnalyzed(int index)
 {
-    m_infoLabel->setText(tr("AI分析完成！"));
+    // 只在进度条停在该手时刷新显示
+    if (index == m_reviewSlider->value()) onReviewSliderMoved(index);
+}
 
+void GameWindow::onReviewSliderMoved(int index)
+{
+    if (!m_review || index < 0 || index >= m_review->turnCount()) return;
+    // 棋盘回到第 index 手; 停在最后一手时恢复显示实时对局
+    if (index >= m_replay.moveCount()) {
+        m_board->exitReplay();
+    } else {
+        m_replay.seek(index);
+        m_board->showReplayPosition(m_replay.board(), m_replay.lastMove());
+    }
+    if (!m_review->hasTurn(index)) {
+        m_board->clearAnalysis();
+        m_infoLabel->setText(tr("第 %1 手: 分析中...").arg(index));
+        return;
+    }
+    const GameReview::Turn &turn = m_review->turn(index);
+    m_board->displayAnalysis(turn.ownership, turn.scoreLead, turn.bestMove);
+    m_infoLabel->setText(tr("第 %1 手: 黑胜率 %2%, %3")
+                         .arg(index)
+                         .arg(QString::number(turn.winrate * 100.0, 'f', 1))
+                         .arg(turn.scoreLead >= 0 ? tr("黑领先 %1 目").arg(QString::number(turn.scoreLead, 'f', 1))
+                                                  : tr("白领先 %1 目").arg(QString::number(-turn.scoreLead, 'f', 1))));
+}
+
+void GameWindow::showAnalysisOnBoard(const QJsonObject &analysisData)
+{
     // 解析所有权数据用于棋盘可视化
     QJsonArray ownershipArr = analysisData.value("ownership").toArray();
     QVector<double> ownershipMap;
+    ownershipMap.reserve(ownershipArr.size());
     for (const auto& val : ownershipArr) {
         ownershipMap.append(val.toDouble());
     }
-    m_board->displayAnalysis(ownershipMap);
+
+    // 推荐点取 moveInfos 中排序第一的着法
+    QPoint best(-1, -1);
+    const QJsonArray moveInfos = analysisData.value("moveInfos").toArray();
+    for (const auto &mv : moveInfos) {
+        QJsonObject info = mv.toObject();
+        if (info.value("order").toInt(-1) != 0) continue;
+        int i = -1, j = -1;
+        if (EngineConnection::parseGtpVertex(info.value("move").toString(), m_board->goban().size(), &i, &j)) {
+            best = QPoint(j, i);
+        }
+        break;
+    }
+
+    double blackScore = analysisData.value("rootInfo").toObject().value("scoreLead").toDouble();
+    m_board->displayAnalysis(ownershipMap, blackScore, best);
+}
+
+void GameWindow::onAnalysisUpdated(const QJsonObject &analysisData)
+{
+    // 中间结果只更新棋盘, 不弹出消息框
+    showAnalysisOnBoard(analysisData);
+    if (m_endAdvicePending) return; // 终局参考估算期间保留服务端结果的提示
+    int visits = analysisData.value("rootInfo").toObject().value("visits").toInt();
+    m_infoLabel->setText(tr("AI分析中... (已搜索 %1 次)").arg(visits));
+}
+
+void GameWindow::onAnalysisReady(const QJsonObject &analysisData)
+{
+    const bool advice = m_endAdvicePending;
+    m_endAdvicePending = false;
+    // 终局参考估算不覆盖 "服务端判定" 的提示
+    if (!advice) m_infoLabel->setText(tr("AI分析完成！"));
+    showAnalysisOnBoard(analysisData);
 
     // 从 "rootInfo" 子对象中读取分数
     QJsonObject rootInfo = analysisData.value("rootInfo").toObject();
     double blackScore = rootInfo.value("scoreLead").toDouble();
 
     // 在消息框中显示结果
-    QString msg = tr("AI 形势判断结果：\n\n");
+    QString msg = advice ? tr("AI 估算 (仅供参考, 胜负以服务端点目为准)：\n\n")
+                         : tr("AI 形势判断结果：\n\n");
     if (blackScore > 0.1) {
         msg += tr("黑棋领先 %1 目").arg(QString::number(blackScore, 'f', 1));
     } else if (blackScore < -0.1) {
@@ -392,18 +532,43 @@ void GameWindow::onAnalysisReady(const QJsonObject &analysisData)
         msg += tr("局势平稳, 胜负接近");
     }
 
-    QMessageBox::information(this, tr("形势判断"), msg);
+    QMessageBox::information(this, advice ? tr("AI 参考点目") : tr("形势判断"), msg);
 }
 
-void GameWindow::onNetworkJsonReceived(const QJsonObject &obj)
+void GameWindow::onAnalysisFailed(const QString &message)
 {
+    // 不再有结果到达: 清掉 "AI分析中..." 的提示, 并允许再次请求
+    m_board->clearAnalysis();
+    if (m_endAdvicePending) {
+        // 终局参考估算失败时保留服务端结果的提示
+        m_endAdvicePending = false;
+        return;
+    }
+    m_infoLabel->setText(tr("AI分析失败: %1").arg(message));
+}
+
+void GameWindow::detachFromNetwork()
+{
+    if (!m_net) return;
+    disconnect(m_net, nullptr, this, nullptr);
+    m_net->dispatcher()->unsubscribe(this);
+}
+
+void GameWindow::onNetworkMessage(MessageDispatcher::Type t, const QJsonObject &obj)
+{
+    using Msg = MessageDispatcher;
     if (m_exiting) return;
-    QString t = obj.value("type").toString();
+    // 观战中的其它房间的消息也经由同一连接到达, 只处理本房间的
+    if (t != Msg::RoomJoined && t != Msg::Matched && obj.contains("room_id")
+        && obj.value("room_id").toString() != m_room.value("room_id").toString()) {
+        return;
+    }
 
-    if (t == "start") {
+    if (t == Msg::Start) {
         if (m_net) m_board->setNetworkManager(m_net);
         QString color = obj.value("color").toString().toLower();
         int c = (color == "black") ? 1 : 2;
+        resetReview();
         m_board->newGame();
         m_board->setLocalPlayerColor(c);
         m_board->setNetworkModeEnabled(true);
@@ -416,12 +581,12 @@ void GameWindow::onNetworkJsonReceived(const QJsonObject &obj)
         return;
     }
 
-    if (t == "player_ready") {
+    if (t == Msg::PlayerReady) {
         m_infoLabel->setText(tr("对手已准备"));
         return;
     }
 
-    if (t == "end_request") {
+    if (t == Msg::EndRequest) {
         // 显示对方的点目请求
         QString prompt = tr("对方请求结束对局并点目, 是否同意？");
         QMessageBox::StandardButton rb = QMessageBox::question(this, tr("点目请求"), prompt, QMessageBox::Yes | QMessageBox::No);
@@ -437,13 +602,25 @@ void GameWindow::onNetworkJsonReceived(const QJsonObject &obj)
         return;
     }
 
-    if (t == "end_confirm") {
-        // 收到双方同意结束的消息, 请求AI进行最终计分
-        if (m_analysisMgr && m_analysisMgr->isRunning()) {
+    if (t == Msg::EndConfirm) {
+        if (obj.contains("winner")) {
+            // 胜负与战绩以服务端点目为准, 始终显示服务端的结果
+            QString msg = tr("点目结束（双方同意）\n黑: %1\n白: %2 (含贴目 %3)\n\n结果: %4")
+                    .arg(obj.value("black_score").toDouble()).arg(obj.value("white_score").toDouble())
+                    .arg(obj.value("komi").toDouble())
+                    .arg(obj.value("winner").toString() == "black" ? tr("黑方获胜") : tr("白方获胜"));
+            QMessageBox::information(this, tr("对局结束 - 点目"), msg);
+            // 引擎可用时另给一份 AI 估算, 仅供参考
+            if (m_analysisMgr && m_analysisMgr->isRunning()) {
+                m_endAdvicePending = true;
+                m_analysisMgr->requestAnalysis();
+            }
+        } else if (m_analysisMgr && m_analysisMgr->isRunning()) {
+            // 对端不是服务端 (直连对局), 没有权威结果: 请求AI进行最终计分
             m_infoLabel->setText(tr("双方同意结束, 正在请求AI点目..."));
             m_analysisMgr->requestAnalysis(); // 结果将在 onAnalysisReady 中显示
         } else {
-            // 若分析引擎出错, 则使用旧的、不精确的计分方法作为后备
+            // 既无服务端结果也无分析引擎, 使用旧的、不精确的计分方法作为后备
             QMessageBox::warning(this, tr("警告"), tr("分析引擎不可用, 将使用旧的计分方法。"));
             auto score = m_board->computeChineseScore();
             int black = score.first, white = score.second;
@@ -461,11 +638,17 @@ void GameWindow::onNetworkJsonReceived(const QJsonObject &obj)
         m_judgeBtn->setEnabled(false);
         m_requestEndBtn->setEnabled(false);
         m_resignBtn->setEnabled(false);
-        m_infoLabel->setText(tr("对局结束, 等待双方准备"));
+        if (obj.contains("winner")) {
+            // 战绩以服务端点目为准
+            m_infoLabel->setText(tr("对局结束 (服务端判定%1), 等待双方准备")
+                                 .arg(obj.value("winner").toString() == "black" ? tr("黑胜") : tr("白胜")));
+        } else {
+            m_infoLabel->setText(tr("对局结束, 等待双方准备"));
+        }
         return;
     }
 
-    if (t == "resign") {
+    if (t == Msg::Resign) {
         QMessageBox::information(this, tr("消息"), tr("对方认输, 你获胜"));
         m_board->setNetworkModeEnabled(false);
         m_readyBtn->setEnabled(true);
@@ -477,15 +660,25 @@ void GameWindow::onNetworkJsonReceived(const QJsonObject &obj)
         return;
     }
 
-    if (t == "opponent_left") {
+    // 对手断线: 服务端保留其座位, 宽限期内重连则对局继续
+    if (t == Msg::OpponentDisconnected) {
+        m_infoLabel->setText(tr("对手连接中断, 等待其重连 (最多 %1 秒)...").arg(obj.value("grace").toInt()));
+        return;
+    }
+    if (t == Msg::OpponentReconnected) {
+        m_infoLabel->setText(tr("对手已重新连接"));
+        return;
+    }
+
+    if (t == Msg::OpponentLeft) {
         QMessageBox::information(this, tr("对手离开"), tr("对手已离开房间"));
-        if (m_net) disconnect(m_net, nullptr, this, nullptr);
+        detachFromNetwork();
         if (m_board) m_board->setNetworkManager(nullptr);
         QTimer::singleShot(0, this, [this]() { emit exitToLobby(); });
         return;
     }
 
-    if (t == "opponent_joined") {
+    if (t == Msg::OpponentJoined) {
         QJsonObject opp = obj.value("opponent").isObject() ? obj.value("opponent").toObject() : QJsonObject();
         if (!opp.isEmpty()) {
             m_room["opponent"] = opp;
@@ -500,13 +693,14 @@ void GameWindow::onNetworkJsonReceived(const QJsonObject &obj)
     }
 
     // "room_joined" 或 "matched" 消息处理
-    if (t == "room_joined" || t == "matched") {
+    if (t == Msg::RoomJoined || t == Msg::Matched) {
         if (obj.contains("you") && obj.value("you").isObject()) m_you = obj.value("you").toObject();
         if (obj.contains("opponent") && obj.value("opponent").isObject()) m_room["opponent"] = obj.value("opponent").toObject();
 
         // 更新UI标签
         QString roomId = obj.value("room_id").toString();
         m_room["room_id"] = roomId;
+        m_board->setRoomId(roomId);
         m_infoLabel->setText(tr("房间: %1").arg(roomId));
         QString yourNick = m_you.value("nickname").toString().isEmpty() ? m_you.value("username").toString() : m_you.value("nickname").toString();
 
@@ -541,7 +735,7 @@ void GameWindow::onNetworkJsonReceived(const QJsonObject &obj)
     }
 
     // 聊天消息处理
-    if (t == "chat") {
+    if (t == Msg::Chat) {
         QString from = obj.value("from").toString();
         QString text = obj.value("text").toString();
         QString time = obj.contains("time") ? obj.value("time").toString() : QDateTime::currentDateTime().toString();
@@ -550,17 +744,26 @@ void GameWindow::onNetworkJsonReceived(const QJsonObject &obj)
         return;
     }
 
-    // 提示类消息 (move/pass)
-    if (t == "move") {
+    // 提示类消息 (move/pass/delta)
+    if (t == Msg::Move) {
         m_infoLabel->setText(tr("收到对手落子"));
         return;
     }
-    if (t == "pass") {
+    if (t == Msg::Pass) {
         m_infoLabel->setText(tr("对手已虚着"));
         return;
     }
+    if (t == Msg::Delta) {
+        m_infoLabel->setText(obj.value("x").toInt(-1) < 0 ? tr("对手已虚着") : tr("收到对手落子"));
+        return;
+    }
+    if (t == Msg::MoveAck) {
+        // 棋盘已自行确认或回滚, 这里只提示被拒绝的情况
+        if (!obj.value("accepted").toBool()) m_infoLabel->setText(tr("落子被服务器拒绝: %1").arg(obj.value("msg").toString()));
+        return;
+    }
 
-    if (t == "error") {
+    if (t == Msg::Error) {
         QString msg = obj.value("msg").toString();
         QMessageBox::warning(this, tr("服务器错误"), msg);
         return;
@@ -575,11 +778,23 @@ void GameWindow::onLeaveRoom()
         QJsonObject obj; obj["type"] = "leave";
         m_net->sendJson(obj);
     }
-    if (m_net) disconnect(m_net, nullptr, this, nullptr);
+    detachFromNetwork();
     if (m_board) m_board->setNetworkManager(nullptr);
     QTimer::singleShot(0, this, [this]() { emit exitToLobby(); });
 }
 
+void GameWindow::updateNetworkStats()
+{
+    if (!m_net) return;
+    const NetworkStats st = m_net->stats();
+    if (st.rttMs < 0) return;
+    QString text = tr("网络: 延迟 %1ms  抖动 %2ms").arg(st.rttMs).arg(st.jitterMs);
+    if (st.queuedBytes > 0) text += tr("  待发送 %1 字节").arg(st.queuedBytes);
+    if (st.peerRttMs >= 0) text += tr("  对手延迟 %1ms").arg(st.peerRttMs);
+    m_netLabel->setText(text);
+    m_netLabel->setVisible(true);
+}
+
 void GameWindow::onLogMessage(const QString &msg)
 {
     // 可选地在状态栏或标签中显示日志
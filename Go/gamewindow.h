@@ -1,6 +1,8 @@
 #include <QWidget>
 #include <QJsonObject>
 #include "singleplayer.h"
+#include "replaymodel.h"
+#include "messagedispatcher.h"
 
 class NetworkManager;
 class BoardWidget;
@@ -8,6 +10,8 @@ class QLabel;
 class QPushButton;
 class QTextEdit;
 class QLineEdit;
+class QSlider;
+class GameReview;
 
 class GameWindow : public QWidget
 {
@@ -26,13 +30,27 @@ private slots:
     void onResignClicked();
     void onReadyClicked();
     void onJudgeClicked();
-    void onNetworkJsonReceived(const QJsonObject &obj);
     void onLogMessage(const QString &msg);
     void onRestartClicked();
     void onChangeSettingsClicked();
+    void onAnalysisUpdated(const QJsonObject& analysisData);
     void onAnalysisReady(const QJsonObject& analysisData);
+    void onAnalysisFailed(const QString &message);
+    void onReviewClicked();
+    void onReviewTurnAnalyzed(int index);
+    void onReviewSliderMoved(int index);
 
 private:
+    // 将分析结果 (所有权/目差/推荐点) 显示到棋盘上
+    void showAnalysisOnBoard(const QJsonObject &analysisData);
+    // 放弃当前复盘: 隐藏进度条并回到实时棋盘 (新的一局开始时调用)
+    void resetReview();
+    // 按类型处理服务端消息 (经 MessageDispatcher 订阅)
+    void onNetworkMessage(MessageDispatcher::Type t, const QJsonObject &obj);
+    // 退订网络消息并断开 NetworkManager 的信号
+    void detachFromNetwork();
+    void updateNetworkStats();
+
     NetworkManager *m_net;
     QJsonObject m_you;
     QJsonObject m_room;
@@ -40,6 +58,7 @@ private:
     QLabel *m_infoLabel;
     QLabel *m_youLabel;
     QLabel *m_oppLabel;
+    QLabel *m_netLabel;        // 网络质量 (往返时延/抖动/待发送字节)
     QTextEdit *m_chatView;
     QLineEdit *m_chatInput;
     QPushButton *m_sendChatBtn;
@@ -49,10 +68,15 @@ private:
     QPushButton *m_leaveBtn;
     QPushButton *m_readyBtn;   // 准备按钮
     QPushButton *m_judgeBtn;   // 形势判断按钮 (仅本地显示)
+    QPushButton *m_reviewBtn;  // 整局复盘按钮
+    QSlider *m_reviewSlider;   // 复盘进度 (按手数)
+    GameReview *m_review = nullptr;
+    ReplayModel m_replay;      // 复盘时按手数回放棋盘
     SinglePlayerManager *m_spMgr = nullptr;
     SinglePlayerManager *m_analysisMgr = nullptr; // 专用于形势判断的Manager
     bool m_exiting;
     bool m_isSinglePlayer = false; // 单机模式标识
+    bool m_endAdvicePending = false; // 终局后的 AI 估算仅作参考, 胜负以服务端点目为准
     QPushButton *m_restartBtn;
     QPushButton *m_changeSettingsBtn;
     // 用于存储单机模式的AI设置
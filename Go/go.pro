@@ -6,24 +6,50 @@ TEMPLATE = app
 
 SOURCES += \
     ai_random.cpp \
+    analysiscache.cpp \
+    analysisservice.cpp \
     boardwidget.cpp \
+    engineconnection.cpp \
+    gamereview.cpp \
     gamewindow.cpp \
     goban.cpp \
+    latencyhistogram.cpp \
+    lineringbuffer.cpp \
     lobbywindow.cpp \
     loginwindow.cpp \
     main.cpp \
+    messagedispatcher.cpp \
     networkmanager.cpp \
-    singleplayer.cpp
+    observationview.cpp \
+    perfmonitor.cpp \
+    perfoverlay.cpp \
+    replaymodel.cpp \
+    singleplayer.cpp \
+    stonespritecache.cpp \
+    wirecodec.cpp
 
 HEADERS += \
     ai_random.h \
+    analysiscache.h \
+    analysisservice.h \
     boardwidget.h \
+    engineconnection.h \
+    gamereview.h \
     gamewindow.h \
     goban.h \
+    latencyhistogram.h \
+    lineringbuffer.h \
     lobbywindow.h \
     loginwindow.h \
+    messagedispatcher.h \
     networkmanager.h \
-    singleplayer.h
+    observationview.h \
+    perfmonitor.h \
+    perfoverlay.h \
+    replaymodel.h \
+    singleplayer.h \
+    stonespritecache.h \
+    wirecodec.h
 
 # adjust if using msys/mingw: uncomment
 # QMAKE_LFLAGS += -static
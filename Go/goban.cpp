@@ -3,6 +3,31 @@
 #include <set>
 #include <algorithm>
 
+namespace {
+// Zobrist 随机表支持的最大路数
+const int kZobristMaxN = 25;
+
+quint64 splitMix64(quint64 &state)
+{
+    quint64 z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// 以固定种子生成, 保证所有进程得到相同的表
+const std::vector<quint64> &zobristTable()
+{
+    static const std::vector<quint64> table = []() {
+        std::vector<quint64> t(kZobristMaxN * kZobristMaxN * 2 + 1);
+        quint64 state = 0x476F42616E5A6FULL;
+        for (auto &k : t) k = splitMix64(state);
+        return t;
+    }();
+    return table;
+}
+}
+
 Goban::Goban(int n)
     : m_n(n), m_cur(1), m_board(n*n, 0)
 {
@@ -14,12 +39,35 @@ int Goban::get(int i, int j) const
     return m_board[idx(i,j)];
 }
 
+quint64 Goban::zobristKey(int i, int j, int color)
+{
+    if (i >= kZobristMaxN || j >= kZobristMaxN) return 0;
+    return zobristTable()[size_t((i * kZobristMaxN + j) * 2 + (color - 1))];
+}
+
+void Goban::recomputeHash()
+{
+    m_stoneHash = 0;
+    for (int i = 0; i < m_n; ++i)
+        for (int j = 0; j < m_n; ++j)
+            if (m_board[idx(i,j)] != 0) m_stoneHash ^= zobristKey(i, j, m_board[idx(i,j)]);
+}
+
+quint64 Goban::hash() const
+{
+    // 表的最后一项表示轮到白方
+    return (m_cur == 2) ? (m_stoneHash ^ zobristTable().back()) : m_stoneHash;
+}
+
 void Goban::reset()
 {
     std::fill(m_board.begin(), m_board.end(), 0);
+    m_stoneHash = 0;
     m_prevSerialized.clear();
     m_lastSerialized.clear();
     m_moveHistory.clear();
+    m_lastMove = {-1, -1};
+    m_lastCaptures.clear();
     m_cur = 1;
 }
 
@@ -34,6 +82,8 @@ void Goban::pass()
     m_prevSerialized = m_lastSerialized;
     m_lastSerialized = serialize();
 
+    m_lastMove = {-1, -1};
+    m_lastCaptures.clear();
     m_cur = 3 - m_cur;
 }
 
@@ -168,8 +218,14 @@ bool Goban::play(int i, int j, QString *err)
 
     m_moveHistory.push_back({{i, j}, m_cur});
 
+    // 增量更新哈希: 新落子与被提的子
+    m_stoneHash ^= zobristKey(i, j, m_cur);
+    for (auto &p : toRemove) m_stoneHash ^= zobristKey(p.first, p.second, opp);
+
     // 将模拟结果应用到实际棋盘
     m_board.swap(copy);
+    m_lastMove = {i, j};
+    m_lastCaptures.swap(toRemove);
 
     // 更新历史记录, 用于劫争判断
     m_prevSerialized = m_lastSerialized;
@@ -313,12 +369,37 @@ bool Goban::deserialize(const std::string &s)
             m_board[idx(i,j)] = int(s[i*m_n + j] - '0');
         }
     }
+    recomputeHash();
+    m_lastMove = {-1, -1};
+    m_lastCaptures.clear();
     // 重置历史记录, 避免同步后出现错误的劫争判断
     m_prevSerialized.clear();
     m_lastSerialized = serialize();
     return true;
 }
 
+QByteArray Goban::packBoard() const
+{
+    QByteArray out((int(m_board.size()) + 3) / 4, '\0');
+    for (int k = 0; k < int(m_board.size()); ++k) {
+        out[k >> 2] = char(uchar(out[k >> 2]) | (m_board[size_t(k)] & 3) << ((k & 3) * 2));
+    }
+    return out;
+}
+
+bool Goban::unpackBoard(const QByteArray &packed)
+{
+    const int cells = m_n * m_n;
+    if (packed.size() != (cells + 3) / 4) return false;
+    std::string s(size_t(cells), '0');
+    for (int k = 0; k < cells; ++k) {
+        int v = (uchar(packed[k >> 2]) >> ((k & 3) * 2)) & 3;
+        if (v > 2) return false;
+        s[size_t(k)] = char('0' + v);
+    }
+    return deserialize(s);
+}
+
 QPair<std::vector<std::pair<int,int>>, int> Goban::getGroupInfo(int i, int j) const
 {
     if (!inBoard(i,j) || get(i,j) == 0) {
@@ -3,7 +3,9 @@
 
 #include <vector>
 #include <QString>
+#include <QByteArray>
 #include <QPair>
+#include <QtGlobal>
 
 /*
  Goban: 管理棋盘状态与规则（含提子、自杀、即时劫(禁止回到上一个历史局面)）
@@ -37,6 +39,13 @@ public:
     std::string serialize() const;
     // 从序列化数据加载棋盘 (若棋盘尺寸不匹配则返回 false)
     bool deserialize(const std::string &s);
+    // 2 位压缩编码: 每字节 4 个交叉点 (行主序, 低位在前), 19 路为 91 字节; 用于网络全量同步
+    QByteArray packBoard() const;
+    // 加载压缩盘面, 语义同 deserialize
+    bool unpackBoard(const QByteArray &packed);
+
+    // 局面哈希 (Zobrist, 含轮到哪方); 种子固定, 不同进程/客户端与服务端之间结果一致
+    quint64 hash() const;
 
     // 设置当前玩家 (用于网络同步)
     void setCurrentPlayer(int p);
@@ -47,6 +56,9 @@ public:
     std::vector<std::pair<int,int>> neighbors(int i,int j) const;
     // 获取历史手数记录
     const std::vector<std::pair<std::pair<int, int>, int>>& getMoveHistory() const;
+    // 最后一手的位置 (虚着/新局/加载盘面后为 (-1,-1)) 与该手提掉的棋子, 用于局部重绘
+    std::pair<int,int> lastMove() const { return m_lastMove; }
+    const std::vector<std::pair<int,int>>& lastCaptures() const { return m_lastCaptures; }
 
 private:
     int m_n;
@@ -57,8 +69,14 @@ private:
     std::string m_prevSerialized;
     std::string m_lastSerialized;
     std::vector<std::pair<std::pair<int, int>, int>> m_moveHistory;
+    // 仅含棋子的 Zobrist 哈希, 随落子/提子增量更新
+    quint64 m_stoneHash = 0;
+    std::pair<int,int> m_lastMove{-1, -1};
+    std::vector<std::pair<int,int>> m_lastCaptures;
 
     // 辅助函数
+    static quint64 zobristKey(int i, int j, int color);
+    void recomputeHash();
     int idx(int i,int j) const { return i*m_n + j; }
     bool inBoard(int i,int j) const { return i>=0 && j>=0 && i<m_n && j<m_n; }
 
@@ -0,0 +1,80 @@
+#include "latencyhistogram.h"
+
+#include <QStringList>
+
+namespace {
+int bucketOf(qint64 us)
+{
+    int k = 0;
+    while (us > 1 && k < LatencyHistogram::BucketCount - 1) {
+        us >>= 1;
+        ++k;
+    }
+    return k;
+}
+
+QString formatUs(qint64 us)
+{
+    if (us >= 1000000) return QString::number(us / 1000000.0, 'f', 2) + "s";
+    if (us >= 1000) return QString::number(us / 1000.0, 'f', 1) + "ms";
+    return QString::number(us) + "us";
+}
+}
+
+void LatencyHistogram::record(qint64 us)
+{
+    us = qMax<qint64>(0, us);
+    ++m_buckets[bucketOf(us)];
+    if (m_count == 0 || us < m_min) m_min = us;
+    if (us > m_max) m_max = us;
+    m_sum += us;
+    ++m_count;
+}
+
+void LatencyHistogram::clear()
+{
+    *this = LatencyHistogram();
+}
+
+qint64 LatencyHistogram::percentile(double p) const
+{
+    if (m_count == 0) return 0;
+    qint64 target = qMax<qint64>(1, qint64(p * m_count + 0.5));
+    qint64 seen = 0;
+    for (int k = 0; k < BucketCount; ++k) {
+        seen += m_buckets[k];
+        if (seen >= target) return qMin(m_max, (qint64(2) << k) - 1);
+    }
+    return m_max;
+}
+
+QString LatencyHistogram::summary() const
+{
+    return QString("n=%1 mean=%2 p50=%3 p90=%4 p99=%5 max=%6")
+            .arg(m_count)
+            .arg(formatUs(qint64(mean())))
+            .arg(formatUs(percentile(0.5)))
+            .arg(formatUs(percentile(0.9)))
+            .arg(formatUs(percentile(0.99)))
+            .arg(formatUs(m_max));
+}
+
+QString LatencyHistogram::toString() const
+{
+    qint64 peak = 0;
+    for (qint64 b : m_buckets) peak = qMax(peak, b);
+    if (peak == 0) return QString();
+
+    QStringList rows;
+    for (int k = 0; k < BucketCount; ++k) {
+        if (m_buckets[k] == 0) continue;
+        qint64 lo = k == 0 ? 0 : (qint64(1) << k);
+        int bar = int((m_buckets[k] * 40 + peak - 1) / peak);
+        rows << QString("%1 - %2 | %3 %4")
+                .arg(formatUs(lo), 8)
+                .arg(formatUs((qint64(2) << k) - 1), -8)
+                .arg(QString(bar, QLatin1Char('#')))
+                .arg(m_buckets[k]);
+    }
+    return rows.join('\n');
+}
@@ -0,0 +1,41 @@
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include <QString>
+#include <QtGlobal>
+
+/*
+ LatencyHistogram: 以 2 的幂为桶宽的延迟直方图 (单位: 微秒)
+  - 第 k 个桶统计 [2^k, 2^(k+1)) 微秒, 记录为 O(1), 内存固定
+  - 分位数按桶上界估算, 误差不超过一倍, 足够区分 IPC (微秒级) 与搜索 (毫秒/秒级)
+*/
+class LatencyHistogram
+{
+public:
+    static const int BucketCount = 32;
+
+    void record(qint64 us);
+    void clear();
+
+    qint64 count() const { return m_count; }
+    qint64 min() const { return m_count ? m_min : 0; }
+    qint64 max() const { return m_max; }
+    double mean() const { return m_count ? double(m_sum) / m_count : 0.0; }
+    // p 取 0~1, 返回该分位数所在桶的上界 (不超过最大值)
+    qint64 percentile(double p) const;
+    qint64 bucket(int k) const { return m_buckets[k]; }
+
+    // 单行摘要: "n=.. mean=.. p50=.. p90=.. p99=.. max=.."
+    QString summary() const;
+    // 各非空桶的文本柱状图
+    QString toString() const;
+
+private:
+    qint64 m_buckets[BucketCount] = {};
+    qint64 m_count = 0;
+    qint64 m_sum = 0;
+    qint64 m_min = 0;
+    qint64 m_max = 0;
+};
+
+#endif // LATENCYHISTOGRAM_H
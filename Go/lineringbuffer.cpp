@@ -0,0 +1,124 @@
+#include "lineringbuffer.h"
+
+#include <QIODevice>
+#include <cstring>
+
+namespace {
+int nextPow2(int v)
+{
+    int p = 1024;
+    while (p < v) p <<= 1;
+    return p;
+}
+}
+
+LineRingBuffer::LineRingBuffer(int capacity)
+{
+    m_buf.resize(nextPow2(capacity));
+}
+
+void LineRingBuffer::clear()
+{
+    m_head = 0;
+    m_size = 0;
+    m_scanned = 0;
+}
+
+int LineRingBuffer::contiguousFree() const
+{
+    const int cap = m_buf.size();
+    int tail = (m_head + m_size) & (cap - 1);
+    if (m_size == cap) return 0;
+    // 写指针在读指针之前 (已回绕) 时, 空闲区到读指针为止; 否则到存储末尾
+    return (tail >= m_head) ? cap - tail : m_head - tail;
+}
+
+void LineRingBuffer::reserveFree(int need)
+{
+    const int cap = m_buf.size();
+    if (cap - m_size >= need) return;
+
+    // 扩容: 按顺序拷贝到新存储的起始位置, 顺便消除回绕
+    QByteArray bigger;
+    bigger.resize(nextPow2(m_size + need));
+    int first = qMin(m_size, cap - m_head);
+    std::memcpy(bigger.data(), m_buf.constData() + m_head, size_t(first));
+    if (first < m_size)
+        std::memcpy(bigger.data() + first, m_buf.constData(), size_t(m_size - first));
+    m_buf.swap(bigger);
+    m_head = 0;
+}
+
+qint64 LineRingBuffer::readFrom(QIODevice *dev)
+{
+    qint64 total = 0;
+    while (dev) {
+        qint64 avail = dev->bytesAvailable();
+        if (avail <= 0) break;
+        reserveFree(int(qMin<qint64>(avail, 1 << 20)));
+
+        const int cap = m_buf.size();
+        int tail = (m_head + m_size) & (cap - 1);
+        int room = contiguousFree();
+        qint64 n = dev->read(m_buf.data() + tail, room);
+        if (n <= 0) break;
+        m_size += int(n);
+        total += n;
+    }
+    return total;
+}
+
+void LineRingBuffer::append(const char *data, int len)
+{
+    while (len > 0) {
+        reserveFree(len);
+        const int cap = m_buf.size();
+        int tail = (m_head + m_size) & (cap - 1);
+        int chunk = qMin(len, contiguousFree());
+        std::memcpy(m_buf.data() + tail, data, size_t(chunk));
+        m_size += chunk;
+        data += chunk;
+        len -= chunk;
+    }
+}
+
+bool LineRingBuffer::nextLine(QByteArray *line)
+{
+    const int cap = m_buf.size();
+    const char *base = m_buf.constData();
+
+    // 只扫描上次之后新到达的字节
+    int lineLen = -1;
+    while (m_scanned < m_size) {
+        int pos = (m_head + m_scanned) & (cap - 1);
+        int chunk = qMin(m_size - m_scanned, cap - pos);
+        const void *hit = std::memchr(base + pos, '\n', size_t(chunk));
+        if (hit) {
+            lineLen = m_scanned + int(static_cast<const char *>(hit) - (base + pos));
+            break;
+        }
+        m_scanned += chunk;
+    }
+    if (lineLen < 0) return false;
+
+    int textLen = lineLen;
+    auto charAt = [&](int off) { return base[(m_head + off) & (cap - 1)]; };
+    if (textLen > 0 && charAt(textLen - 1) == '\r') --textLen;
+
+    if (m_head + textLen <= cap) {
+        *line = QByteArray::fromRawData(base + m_head, textLen);
+    } else {
+        // 行跨越存储末尾, 拼接到临时缓冲区
+        int first = cap - m_head;
+        m_scratch.resize(textLen);
+        std::memcpy(m_scratch.data(), base + m_head, size_t(first));
+        std::memcpy(m_scratch.data() + first, base, size_t(textLen - first));
+        *line = m_scratch;
+    }
+
+    m_head = (m_head + lineLen + 1) & (cap - 1);
+    m_size -= lineLen + 1;
+    m_scanned = 0;
+    if (m_size == 0) m_head = 0;
+    return true;
+}
@@ -0,0 +1,45 @@
+#ifndef LINERINGBUFFER_H
+#define LINERINGBUFFER_H
+
+#include <QByteArray>
+#include <QtGlobal>
+
+class QIODevice;
+
+/*
+ LineRingBuffer: 按行切分进程输出的环形缓冲区
+  - 数据直接从 QIODevice 读入环形存储, 不经过中间 QByteArray
+  - 每个字节只扫描一次换行符, 取出一行为 O(1) (仅移动读指针)
+  - 返回的行在未回绕时是指向内部存储的只读视图 (fromRawData), 仅在下一次 readFrom() 之前有效
+*/
+class LineRingBuffer
+{
+public:
+    explicit LineRingBuffer(int capacity = 64 * 1024);
+
+    // 从设备读取所有可用数据, 返回读取的字节数
+    qint64 readFrom(QIODevice *dev);
+
+    // 追加一段数据 (主要用于非 QIODevice 来源)
+    void append(const char *data, int len);
+
+    // 取出下一完整行 (不含 '\n' 与行尾 '\r'); 暂无完整行时返回 false
+    bool nextLine(QByteArray *line);
+
+    int size() const { return m_size; }
+    void clear();
+
+private:
+    // 保证至少还有 need 字节的空闲空间, 必要时扩容并线性化
+    void reserveFree(int need);
+    // 写指针之后连续可写的字节数
+    int contiguousFree() const;
+
+    QByteArray m_buf;   // 环形存储 (容量恒为 2 的幂)
+    int m_head = 0;     // 读指针
+    int m_size = 0;     // 已缓存字节数
+    int m_scanned = 0;  // 从 m_head 起已确认不含 '\n' 的字节数
+    QByteArray m_scratch; // 行跨越存储末尾时用于拼接
+};
+
+#endif // LINERINGBUFFER_H
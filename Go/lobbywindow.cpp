@@ -1,5 +1,6 @@
 #include "lobbywindow.h"
 #include "networkmanager.h"
+#include "observationview.h"
 
 #include <QVBoxLayout>
 #include <QHBoxLayout>
@@ -34,6 +35,7 @@ LobbyWindow::LobbyWindow(NetworkManager *netMgr, const QJsonObject &userInfo, QW
     main->addWidget(m_profileLabel);
 
     m_roomList = new QListWidget(this);
+    m_roomList->setSelectionMode(QAbstractItemView::ExtendedSelection);
     main->addWidget(m_roomList, 1);
 
     // 功能按钮
@@ -60,6 +62,9 @@ LobbyWindow::LobbyWindow(NetworkManager *netMgr, const QJsonObject &userInfo, QW
     m_singleBtn = new QPushButton(tr("单机对战"), this);
     btns->addWidget(m_singleBtn);
 
+    m_observeBtn = new QPushButton(tr("观战"), this);
+    btns->addWidget(m_observeBtn);
+
     connect(m_createBtn, &QPushButton::clicked, this, &LobbyWindow::onCreateRoom);
     connect(m_joinBtn, &QPushButton::clicked, this, &LobbyWindow::onJoinRoom);
     connect(m_matchBtn, &QPushButton::clicked, this, &LobbyWindow::onMatch);
@@ -67,8 +72,12 @@ LobbyWindow::LobbyWindow(NetworkManager *netMgr, const QJsonObject &userInfo, QW
     connect(m_logoutBtn, &QPushButton::clicked, this, &LobbyWindow::onLogout);
     connect(m_refreshBtn, &QPushButton::clicked, this, &LobbyWindow::onRefreshRooms);
     connect(m_singleBtn, &QPushButton::clicked, this, &LobbyWindow::onSinglePlayer);
+    connect(m_observeBtn, &QPushButton::clicked, this, &LobbyWindow::onObserve);
 
-    connect(m_net, &NetworkManager::jsonReceived, this, &LobbyWindow::onNetworkJsonReceived, Qt::QueuedConnection);
+    using Msg = MessageDispatcher;
+    m_net->dispatcher()->subscribe(
+        {Msg::RoomList, Msg::RoomListDelta, Msg::MatchCancelled, Msg::RoomJoined, Msg::Matched, Msg::Waiting, Msg::Start, Msg::Error},
+        this, [this](Msg::Type t, const QJsonObject &obj) { onNetworkMessage(t, obj); });
     connect(m_net, &NetworkManager::logMessage, this, &LobbyWindow::onLogMessage, Qt::QueuedConnection);
 
 
@@ -139,30 +148,38 @@ void LobbyWindow::onRefreshRooms()
     m_status->setText(tr("请求房间列表..."));
 }
 
-void LobbyWindow::onNetworkJsonReceived(const QJsonObject &obj)
+void LobbyWindow::onNetworkMessage(MessageDispatcher::Type t, const QJsonObject &obj)
 {
-    QString t = obj.value("type").toString();
-
-    if (t == "room_list") {
-        // 更新房间列表
+    using Msg = MessageDispatcher;
+    if (t == Msg::RoomList) {
+        // 全量快照: 替换整个房间列表
         m_roomList->clear();
         QJsonArray arr = obj.value("rooms").toArray();
-        for (auto v : arr) {
-            QJsonObject r = v.toObject();
-            QString rid = r.value("room_id").toString();
-            int players = r.value("players").toInt();
-            QString status = r.value("status").toString();
-            QString text = tr("房间 %1  [%2人] 状态:%3").arg(rid).arg(players).arg(status);
-            if (r.contains("p1")) text += "\n  " + r.value("p1").toObject().value("nickname").toString();
-            if (r.contains("p2")) text += "\n  " + r.value("p2").toObject().value("nickname").toString();
-            QListWidgetItem *it = new QListWidgetItem(text, m_roomList);
-            it->setData(Qt::UserRole, rid);
-        }
+        for (auto v : arr) upsertRoomItem(v.toObject());
+        // 旧版服务端的列表不带版本号, 也不会发送增量
+        m_roomListSynced = obj.contains("version");
+        m_roomListVersion = quint64(obj.value("version").toDouble());
         m_status->setText(tr("房间列表已更新"));
         return;
     }
 
-    if (t == "match_cancelled") {
+    if (t == Msg::RoomListDelta) {
+        const quint64 version = quint64(obj.value("version").toDouble());
+        if (!m_roomListSynced) return; // 等待快照
+        if (version != m_roomListVersion + 1) {
+            // 漏掉了中间的增量, 重新请求快照
+            m_roomListSynced = false;
+            m_net->sendJson(QJsonObject{{"type","list_rooms"}});
+            return;
+        }
+        for (auto v : obj.value("added").toArray()) upsertRoomItem(v.toObject());
+        for (auto v : obj.value("updated").toArray()) upsertRoomItem(v.toObject());
+        for (auto v : obj.value("removed").toArray()) removeRoomItem(v.toString());
+        m_roomListVersion = version;
+        return;
+    }
+
+    if (t == Msg::MatchCancelled) {
         m_status->setText(obj.value("msg").toString());
         m_matchBtn->setEnabled(true);
         m_cancelMatchBtn->setEnabled(false);
@@ -170,7 +187,7 @@ void LobbyWindow::onNetworkJsonReceived(const QJsonObject &obj)
     }
 
     // 收到 "room_joined" 消息, 准备进入房间
-    if (t == "room_joined") {
+    if (t == Msg::RoomJoined) {
         // 如果已在房间内, 忽略重复的消息 (幂等保护)
         if (m_inRoom) {
             qDebug() << "[Lobby] already in room, ignoring duplicate room_joined";
@@ -205,6 +222,7 @@ void LobbyWindow::onNetworkJsonReceived(const QJsonObject &obj)
         if (obj.contains("color")) roominfo["color"] = obj.value("color");
 
         m_inRoom = true; // 标记为已进入房间, 避免重复进入
+        subscribeLobby(false);
         m_matchBtn->setEnabled(true);
         m_cancelMatchBtn->setEnabled(false);
 
@@ -215,7 +233,7 @@ void LobbyWindow::onNetworkJsonReceived(const QJsonObject &obj)
     }
 
     // "matched" 消息也视为进入房间
-    if (t == "matched") {
+    if (t == Msg::Matched) {
         if (m_inRoom) {
             qDebug() << "[Lobby] already in room, ignoring duplicate matched";
             return;
@@ -246,6 +264,7 @@ void LobbyWindow::onNetworkJsonReceived(const QJsonObject &obj)
         roominfo["color"] = color;
 
         m_inRoom = true;
+        subscribeLobby(false);
         qDebug() << "[Lobby] entering matched room, roominfo:" << QJsonDocument(roominfo).toJson(QJsonDocument::Compact);
 
         m_matchBtn->setEnabled(true);
@@ -254,17 +273,17 @@ void LobbyWindow::onNetworkJsonReceived(const QJsonObject &obj)
         return;
     }
 
-    if (t == "waiting") {
+    if (t == Msg::Waiting) {
         m_status->setText(obj.value("msg").toString());
         return;
     }
 
-    if (t == "start") {
+    if (t == Msg::Start) {
         m_status->setText(tr("房间开始对局"));
         return;
     }
 
-    if (t == "error") {
+    if (t == Msg::Error) {
         QString msg = obj.value("msg").toString();
         QMessageBox::warning(this, tr("错误"), msg);
         m_status->setText(tr("错误: %1").arg(msg));
@@ -280,6 +299,37 @@ void LobbyWindow::onLogMessage(const QString &msg)
     m_status->setText(msg);
 }
 
+void LobbyWindow::upsertRoomItem(const QJsonObject &r)
+{
+    QString rid = r.value("room_id").toString();
+    int players = r.value("players").toInt();
+    QString status = r.value("status").toString();
+    QString text = tr("房间 %1  [%2人] 状态:%3").arg(rid).arg(players).arg(status);
+    if (r.contains("p1")) text += "\n  " + r.value("p1").toObject().value("nickname").toString();
+    if (r.contains("p2")) text += "\n  " + r.value("p2").toObject().value("nickname").toString();
+
+    // 原地更新, 保留用户的选中状态
+    for (int i = 0; i < m_roomList->count(); ++i) {
+        QListWidgetItem *it = m_roomList->item(i);
+        if (it->data(Qt::UserRole).toString() == rid) {
+            it->setText(text);
+            return;
+        }
+    }
+    QListWidgetItem *it = new QListWidgetItem(text, m_roomList);
+    it->setData(Qt::UserRole, rid);
+}
+
+void LobbyWindow::removeRoomItem(const QString &roomId)
+{
+    for (int i = 0; i < m_roomList->count(); ++i) {
+        if (m_roomList->item(i)->data(Qt::UserRole).toString() == roomId) {
+            delete m_roomList->takeItem(i);
+            return;
+        }
+    }
+}
+
 void LobbyWindow::setInRoom(bool inRoom)
 {
     m_inRoom = inRoom;
@@ -288,9 +338,19 @@ void LobbyWindow::setInRoom(bool inRoom)
         m_matchBtn->setEnabled(true);
         m_cancelMatchBtn->setEnabled(false);
         m_status->setText(tr("已回到大厅"));
+        subscribeLobby(true);
     }
 }
 
+void LobbyWindow::subscribeLobby(bool on)
+{
+    // 重新订阅时服务端先发快照, 在此之前的增量一律忽略
+    m_roomListSynced = false;
+    if (!m_net->isConnected()) return;
+    m_net->sendJson(QJsonObject{{"type", on ? QStringLiteral("subscribe") : QStringLiteral("unsubscribe")},
+                                {"topic", QStringLiteral("lobby")}});
+}
+
 void LobbyWindow::onSinglePlayer()
 {
     // 弹窗让玩家选择执子颜色
@@ -320,5 +380,30 @@ void LobbyWindow::onSinglePlayer()
 
     // 直接进入房间
     m_inRoom = true;
+    subscribeLobby(false);
     emit enterRoom(roominfo);
 }
+
+void LobbyWindow::onObserve()
+{
+    if (!m_net->isConnected()) { QMessageBox::warning(this, tr("未连接"), tr("请先连接服务器")); return; }
+    const QList<QListWidgetItem *> items = m_roomList->selectedItems();
+    if (items.isEmpty()) {
+        m_status->setText(tr("请先在列表中选择要观战的房间 (可多选)"));
+        return;
+    }
+
+    if (!m_observeView) {
+        m_observeView = new ObservationView(m_net);
+        m_observeView->setAttribute(Qt::WA_DeleteOnClose);
+        m_observeView->setWindowTitle(tr("观战"));
+        m_observeView->resize(1000, 760);
+    }
+    for (QListWidgetItem *it : items) {
+        QString rid = it->data(Qt::UserRole).toString();
+        m_observeView->observe(rid, tr("房间 %1").arg(rid));
+    }
+    m_observeView->show();
+    m_observeView->raise();
+    m_status->setText(tr("正在观战 %1 盘对局").arg(m_observeView->boardCount()));
+}
@@ -3,11 +3,14 @@
 
 #include <QWidget>
 #include <QJsonObject>
+#include <QPointer>
+#include "messagedispatcher.h"
 
 class NetworkManager;
 class QLabel;
 class QListWidget;
 class QPushButton;
+class ObservationView;
 
 class LobbyWindow : public QWidget
 {
@@ -32,11 +35,18 @@ private slots:
     void onCancelMatch();
     void onLogout();
     void onRefreshRooms();
-    void onNetworkJsonReceived(const QJsonObject &obj);
     void onLogMessage(const QString &msg);
     void onSinglePlayer();
+    void onObserve();
 
 private:
+    void onNetworkMessage(MessageDispatcher::Type t, const QJsonObject &obj);
+    // 新增或更新一个房间条目 (按 room_id 查找)
+    void upsertRoomItem(const QJsonObject &room);
+    void removeRoomItem(const QString &roomId);
+    // 显示大厅时订阅房间列表 (先收到快照), 进入房间后退订
+    void subscribeLobby(bool on);
+
     NetworkManager *m_net;
     QJsonObject m_user;
     QLabel *m_profileLabel;
@@ -48,8 +58,14 @@ private:
     QPushButton *m_logoutBtn;
     QPushButton *m_refreshBtn;
     QPushButton *m_singleBtn = nullptr;
+    QPushButton *m_observeBtn = nullptr;
+    // 所有观战的棋盘共用一个窗口
+    QPointer<ObservationView> m_observeView;
     QLabel *m_status;
     bool m_inRoom = false;
+    // 房间列表版本: 收到快照后按版本号依次应用增量, 不连续时重新请求快照
+    quint64 m_roomListVersion = 0;
+    bool m_roomListSynced = false;
 };
 
 #endif // LOBBYWINDOW_H
@@ -46,7 +46,8 @@ LoginWindow::LoginWindow(NetworkManager *netMgr, QWidget *parent)
     // 连接网络信号
     connect(m_net, &NetworkManager::connected, this, &LoginWindow::onConnectStateChanged);
     connect(m_net, &NetworkManager::disconnected, this, &LoginWindow::onConnectStateChanged);
-    connect(m_net, &NetworkManager::jsonReceived, this, &LoginWindow::onNetworkJsonReceived);
+    m_net->dispatcher()->subscribe({MessageDispatcher::RegisterResult, MessageDispatcher::LoginResult}, this,
+                                   [this](MessageDispatcher::Type t, const QJsonObject &obj) { onNetworkMessage(t, obj); });
     connect(m_net, &NetworkManager::logMessage, this, &LoginWindow::onLogMessage);
 
     // 尝试立即连接到固定的服务器地址
@@ -105,10 +106,10 @@ void LoginWindow::onLoginClicked()
     m_statusLabel->setText(tr("正在登录..."));
 }
 
-void LoginWindow::onNetworkJsonReceived(const QJsonObject &obj)
+void LoginWindow::onNetworkMessage(MessageDispatcher::Type t, const QJsonObject &obj)
 {
-    QString t = obj.value("type").toString();
-    if (t == "register_result") {
+    using Msg = MessageDispatcher;
+    if (t == Msg::RegisterResult) {
         bool ok = obj.value("success").toBool();
         QString msg = obj.value("msg").toString();
         if (ok) QMessageBox::information(this, tr("注册成功"), msg);
@@ -116,7 +117,7 @@ void LoginWindow::onNetworkJsonReceived(const QJsonObject &obj)
         m_statusLabel->setText(tr("等待操作"));
         return;
     }
-    if (t == "login_result") {
+    if (t == Msg::LoginResult) {
         bool ok = obj.value("success").toBool();
         if (!ok) {
             QMessageBox::warning(this, tr("登录失败"), obj.value("msg").toString());
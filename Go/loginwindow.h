@@ -3,6 +3,7 @@
 
 #include <QWidget>
 #include <QJsonObject>
+#include "messagedispatcher.h"
 
 class NetworkManager;
 class QLineEdit;
@@ -23,10 +24,11 @@ private slots:
     void onConnectStateChanged();
     void onRegisterClicked();
     void onLoginClicked();
-    void onNetworkJsonReceived(const QJsonObject &obj);
     void onLogMessage(const QString &msg);
 
 private:
+    void onNetworkMessage(MessageDispatcher::Type t, const QJsonObject &obj);
+
     NetworkManager *m_net;
     QLineEdit *m_userEdit;
     QLineEdit *m_passEdit;
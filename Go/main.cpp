@@ -1,15 +1,37 @@
 // main.cpp
 #include <QApplication>
 #include <QJsonObject>
+#include <QTimer>
 #include "networkmanager.h"
 #include "loginwindow.h"
 #include "lobbywindow.h"
 #include "gamewindow.h"
+#include "analysisservice.h"
+#include "perfmonitor.h"
 
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
 
+    // 共享 KataGo 分析进程数量 (默认 1), 可通过环境变量 GOQT_ANALYSIS_PROCESSES 调整
+    int analysisProcesses = qEnvironmentVariableIntValue("GOQT_ANALYSIS_PROCESSES");
+    if (analysisProcesses > 0) AnalysisService::instance()->setProcessCount(analysisProcesses);
+    // 可选预热: 设置 GOQT_PREWARM_ANALYSIS=1 时在事件循环启动后立即后台加载模型
+    if (qEnvironmentVariableIntValue("GOQT_PREWARM_ANALYSIS") > 0) {
+        QTimer::singleShot(0, AnalysisService::instance(), &AnalysisService::prewarm);
+    }
+
+    // 性能埋点: GOQT_PERF=1 开启 (对局窗口显示悬浮面板), GOQT_PERF_TRACE=<路径> 退出时导出 Chrome trace
+    if (PerfMonitor::isEnabled()) {
+        PerfMonitor::instance()->startStallDetector();
+        QString tracePath = qEnvironmentVariable("GOQT_PERF_TRACE");
+        if (!tracePath.isEmpty()) {
+            QObject::connect(&a, &QCoreApplication::aboutToQuit, [tracePath]() {
+                PerfMonitor::instance()->writeChromeTrace(tracePath);
+            });
+        }
+    }
+
     // 全局共享的网络管理器 (使用 new 创建以确保在各窗口间传递指针时其生命周期稳定)
     NetworkManager *netMgr = new NetworkManager(nullptr);
 
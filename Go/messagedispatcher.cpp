@@ -0,0 +1,94 @@
+#include "messagedispatcher.h"
+
+#include <QHash>
+
+MessageDispatcher::Type MessageDispatcher::typeOf(const QString &name)
+{
+    static const QHash<QString, Type> table = {
+        {QStringLiteral("error"), Error},
+        {QStringLiteral("register_result"), RegisterResult},
+        {QStringLiteral("login_result"), LoginResult},
+        {QStringLiteral("logout_result"), LogoutResult},
+        {QStringLiteral("room_list"), RoomList},
+        {QStringLiteral("room_list_delta"), RoomListDelta},
+        {QStringLiteral("room_joined"), RoomJoined},
+        {QStringLiteral("opponent_joined"), OpponentJoined},
+        {QStringLiteral("opponent_left"), OpponentLeft},
+        {QStringLiteral("opponent_disconnected"), OpponentDisconnected},
+        {QStringLiteral("opponent_reconnected"), OpponentReconnected},
+        {QStringLiteral("matched"), Matched},
+        {QStringLiteral("waiting"), Waiting},
+        {QStringLiteral("match_cancelled"), MatchCancelled},
+        {QStringLiteral("player_ready"), PlayerReady},
+        {QStringLiteral("start"), Start},
+        {QStringLiteral("newgame"), NewGame},
+        {QStringLiteral("move"), Move},
+        {QStringLiteral("pass"), Pass},
+        {QStringLiteral("turn"), Turn},
+        {QStringLiteral("delta"), Delta},
+        {QStringLiteral("move_ack"), MoveAck},
+        {QStringLiteral("sync"), Sync},
+        {QStringLiteral("resync_request"), ResyncRequest},
+        {QStringLiteral("game_update"), GameUpdate},
+        {QStringLiteral("resign"), Resign},
+        {QStringLiteral("chat"), Chat},
+        {QStringLiteral("end_request"), EndRequest},
+        {QStringLiteral("end_confirm"), EndConfirm},
+        {QStringLiteral("end_decline"), EndDecline},
+        {QStringLiteral("spectate_result"), SpectateResult},
+        {QStringLiteral("room_closed"), RoomClosed},
+    };
+    return table.value(name, Unknown);
+}
+
+void MessageDispatcher::subscribe(std::initializer_list<Type> types, QObject *receiver, const Handler &handler)
+{
+    for (Type t : types) {
+        if (t <= Unknown || t >= TypeCount) continue;
+        m_subscribers[t].append({QPointer<QObject>(receiver), handler});
+    }
+}
+
+void MessageDispatcher::unsubscribe(QObject *receiver)
+{
+    for (auto &list : m_subscribers) {
+        for (Subscriber &s : list) {
+            if (s.receiver == receiver) {
+                s.receiver = nullptr;
+                m_dirty = true;
+            }
+        }
+    }
+    compact();
+}
+
+void MessageDispatcher::dispatch(Type type, const QJsonObject &obj)
+{
+    if (type <= Unknown || type >= TypeCount) return;
+    ++m_dispatchDepth;
+    // 按下标遍历: 处理函数里新增的订阅者追加在末尾, 不参与本次分发
+    const int count = m_subscribers[type].size();
+    for (int k = 0; k < count; ++k) {
+        const Subscriber &s = m_subscribers[type][k];
+        if (!s.receiver) {
+            m_dirty = true;
+            continue;
+        }
+        // 复制一份再调用, 处理函数内的订阅可能使列表重新分配
+        Handler h = s.handler;
+        h(type, obj);
+    }
+    --m_dispatchDepth;
+    compact();
+}
+
+void MessageDispatcher::compact()
+{
+    if (m_dispatchDepth > 0 || !m_dirty) return;
+    for (auto &list : m_subscribers) {
+        for (int k = list.size() - 1; k >= 0; --k) {
+            if (!list[k].receiver) list.remove(k);
+        }
+    }
+    m_dirty = false;
+}
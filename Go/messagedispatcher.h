@@ -0,0 +1,82 @@
+#ifndef MESSAGEDISPATCHER_H
+#define MESSAGEDISPATCHER_H
+
+#include <QObject>
+#include <QPointer>
+#include <QVector>
+#include <QJsonObject>
+#include <functional>
+#include <initializer_list>
+
+/*
+ MessageDispatcher: 按消息类型把服务端消息分发给订阅者
+  - 消息类型字符串只在收到时查表一次, 订阅者拿到枚举值, 不再逐个比较字符串
+  - 每条消息只调用订阅了该类型的处理函数, 打开的窗口再多也不会让每条消息的开销随之增长
+  - 订阅者销毁后自动失效; 分发过程中订阅/退订是安全的 (新订阅者不会收到当前这条消息)
+*/
+class MessageDispatcher
+{
+public:
+    enum Type {
+        Unknown = 0,
+        Error,
+        RegisterResult,
+        LoginResult,
+        LogoutResult,
+        RoomList,
+        RoomListDelta,
+        RoomJoined,
+        OpponentJoined,
+        OpponentLeft,
+        OpponentDisconnected,
+        OpponentReconnected,
+        Matched,
+        Waiting,
+        MatchCancelled,
+        PlayerReady,
+        Start,
+        NewGame,
+        Move,
+        Pass,
+        Turn,
+        Delta,
+        MoveAck,
+        Sync,
+        ResyncRequest,
+        GameUpdate,
+        Resign,
+        Chat,
+        EndRequest,
+        EndConfirm,
+        EndDecline,
+        SpectateResult,
+        RoomClosed,
+        TypeCount
+    };
+
+    using Handler = std::function<void(Type, const QJsonObject &)>;
+
+    static Type typeOf(const QString &name);
+
+    // 订阅若干类型的消息, receiver 销毁后自动失效
+    void subscribe(std::initializer_list<Type> types, QObject *receiver, const Handler &handler);
+    // 退订 receiver 的所有订阅
+    void unsubscribe(QObject *receiver);
+    // 同步调用该类型的所有订阅者
+    void dispatch(Type type, const QJsonObject &obj);
+
+private:
+    struct Subscriber {
+        QPointer<QObject> receiver;
+        Handler handler;
+    };
+    // 清除已退订或已销毁的订阅者 (仅在没有进行中的分发时)
+    void compact();
+
+    QVector<Subscriber> m_subscribers[TypeCount];
+    // 处理函数中可能弹出模态对话框而嵌套分发, 只在最外层结束后整理列表
+    int m_dispatchDepth = 0;
+    bool m_dirty = false;
+};
+
+#endif // MESSAGEDISPATCHER_H
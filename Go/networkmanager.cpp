@@ -1,12 +1,38 @@
 #include "networkmanager.h"
-#include <QJsonDocument>
+#include "perfmonitor.h"
+#include <QJsonArray>
 #include <QHostAddress>
+#include <QRandomGenerator>
+#include <QTimer>
+#include <QMetaMethod>
+#include <QDebug>
+
+namespace {
+// 重连退避: 首次约 0.5 秒, 每次翻倍, 单次最长 16 秒
+const int kReconnectBaseMs = 500;
+const int kReconnectMaxMs = 16000;
+// 重连窗口, 略短于服务端保留会话的 60 秒宽限期
+const qint64 kResumeWindowMs = 55000;
+// 每收到这么多条消息回执一次
+const quint64 kAckInterval = 32;
+// 待确认队列上限, 超出后丢弃最旧的消息
+const int kSentLogLimit = 1024;
+// ping 间隔, 以及多久收不到 pong 视为连接已失效
+const int kPingIntervalMs = 2000;
+const qint64 kPongTimeoutMs = 10000;
+}
 
 NetworkManager::NetworkManager(QObject *parent)
-    : QObject(parent)
+    : QObject(parent),
+      m_reconnectTimer(new QTimer(this)),
+      m_pingTimer(new QTimer(this))
 {
     // 注册元类型, 以支持在 QueuedConnection 模式下使用 QJsonObject 作为参数
     qRegisterMetaType<QJsonObject>("QJsonObject");
+    m_reconnectTimer->setSingleShot(true);
+    connect(m_reconnectTimer, &QTimer::timeout, this, &NetworkManager::onReconnectTimeout);
+    connect(m_pingTimer, &QTimer::timeout, this, &NetworkManager::sendPing);
+    m_clock.start();
 }
 
 
@@ -21,8 +47,14 @@ NetworkManager::~NetworkManager()
 
 void NetworkManager::emitJsonReceived(const QJsonObject &obj)
 {
-    // 统一通过此函数发射信号, 确保所有接收方都在事件循环中异步处理
-    emit jsonReceived(obj);
+    deliver(MessageDispatcher::typeOf(obj.value("type").toString()), obj);
+}
+
+void NetworkManager::deliver(MessageDispatcher::Type type, const QJsonObject &obj)
+{
+    m_dispatcher.dispatch(type, obj);
+    static const QMetaMethod signal = QMetaMethod::fromSignal(&NetworkManager::jsonReceived);
+    if (isSignalConnected(signal)) emit jsonReceived(obj);
 }
 
 bool NetworkManager::startHost(quint16 port)
@@ -61,27 +93,63 @@ void NetworkManager::stopHost()
 }
 
 void NetworkManager::connectToHost(const QUrl &url)
+{
+    // 新的连接即新的会话
+    m_reconnectTimer->stop();
+    m_reconnecting = false;
+    resetSession();
+    m_url = url;
+    m_isHosting = false;
+    openSocket();
+}
+
+void NetworkManager::openSocket()
 {
     // 创建客户端套接字 (用于连接中央服务器)
     if (m_socket) {
+        disconnect(m_socket, nullptr, this, nullptr);
         m_socket->abort();
         m_socket->deleteLater();
         m_socket = nullptr;
     }
     m_socket = new QWebSocket();
+    m_format = WireCodec::Json;
+    m_helloPending = false;
     connect(m_socket, &QWebSocket::connected, this, [this]() {
+        if (m_reconnecting) {
+            // 重连成功: 先协商编码, 再凭令牌接管原会话
+            emit logMessage(QStringLiteral("已重新连接, 正在恢复会话..."));
+            sendHello();
+            m_resuming = true;
+            sendJson(QJsonObject{{"type", "resume"}, {"token", m_resumeToken}, {"received", double(m_recvCount)}});
+            return;
+        }
         emit logMessage(QStringLiteral("已连接到服务器"));
+        sendHello();
         emit connected();
     });
+    connect(m_socket, &QWebSocket::connected, this, [this]() {
+        m_lastPongMs = m_clock.elapsed();
+        m_pingSupported = false;
+        m_pingProbePending = false;
+        m_pingTimer->start(kPingIntervalMs);
+    });
     connect(m_socket, &QWebSocket::disconnected, this, &NetworkManager::onSocketDisconnected);
+    // 连接失败时不一定会发出 disconnected, 重连期间同样视为断开
+    connect(m_socket, QOverload<QAbstractSocket::SocketError>::of(&QWebSocket::error), this, [this](QAbstractSocket::SocketError) {
+        if (m_reconnecting && m_socket && m_socket->state() != QAbstractSocket::ConnectedState) onSocketDisconnected();
+    });
     connect(m_socket, &QWebSocket::textMessageReceived, this, &NetworkManager::onSocketTextMessageReceived);
+    connect(m_socket, &QWebSocket::binaryMessageReceived, this, &NetworkManager::onSocketBinaryMessageReceived);
 
-    m_socket->open(url);
-    m_isHosting = false;
+    m_socket->open(m_url);
 }
 
 void NetworkManager::disconnectFromHost()
 {
+    m_reconnectTimer->stop();
+    m_reconnecting = false;
+    resetSession();
     if (m_socket) {
         disconnect(m_socket, nullptr, this, nullptr);
         m_socket->close();
@@ -102,7 +170,9 @@ void NetworkManager::onNewConnection()
         return;
     }
     m_socket = m_server->nextPendingConnection();
+    m_format = WireCodec::Json;
     connect(m_socket, &QWebSocket::textMessageReceived, this, &NetworkManager::onSocketTextMessageReceived);
+    connect(m_socket, &QWebSocket::binaryMessageReceived, this, &NetworkManager::onSocketBinaryMessageReceived);
     connect(m_socket, &QWebSocket::disconnected, this, &NetworkManager::onSocketDisconnected);
     emit logMessage(QStringLiteral("有玩家连接 (Host已接受)"));
     emit connected();
@@ -110,38 +180,282 @@ void NetworkManager::onNewConnection()
 
 void NetworkManager::onSocketTextMessageReceived(const QString &message)
 {
-    QJsonParseError err;
-    QJsonDocument doc = QJsonDocument::fromJson(message.toUtf8(), &err);
-    if (err.error != QJsonParseError::NoError || !doc.isObject()) {
-        emit logMessage(QStringLiteral("收到非法的JSON数据"));
+    PerfScope perf(PerfMonitor::NetMessage);
+    handleIncoming(message.toUtf8(), false);
+}
+
+void NetworkManager::onSocketBinaryMessageReceived(const QByteArray &message)
+{
+    PerfScope perf(PerfMonitor::NetMessage);
+    handleIncoming(message, true);
+}
+
+void NetworkManager::sendHello()
+{
+    // GOQT_WIRE=json 时不协商, 便于抓包调试
+    if (qEnvironmentVariable("GOQT_WIRE") == QLatin1String("json")) return;
+    QJsonObject hello;
+    hello["type"] = "hello";
+    hello["codecs"] = QJsonArray::fromStringList(WireCodec::supportedNames());
+    m_helloPending = true;
+    sendJson(hello);
+}
+
+void NetworkManager::handleIncoming(const QByteArray &data, bool binary)
+{
+    QJsonObject obj;
+    if (!WireCodec::decode(data, binary, &obj)) {
+        emit logMessage(binary ? QStringLiteral("收到非法的二进制数据") : QStringLiteral("收到非法的JSON数据"));
         return;
     }
-    QJsonObject obj = doc.object();
+
+    // 编码协商: 对方 (作为主机时) 发起 hello, 或服务端回复 hello_ack
+    const QString type = obj.value("type").toString();
+    if (type == "hello") {
+        WireCodec::Format format = WireCodec::negotiate(obj.value("codecs").toVariant().toStringList());
+        // 确认消息仍以 JSON 发送, 之后再切换
+        sendJson(QJsonObject{{"type", "hello_ack"}, {"codec", WireCodec::formatName(format)}});
+        m_format = format;
+        return;
+    }
+    if (type == "hello_ack") {
+        m_helloPending = false;
+        m_pingSupported = true;
+        m_format = obj.value("codec").toString() == WireCodec::formatName(WireCodec::Cbor) ? WireCodec::Cbor : WireCodec::Json;
+        qDebug() << "[Network] 消息编码:" << WireCodec::formatName(m_format);
+        return;
+    }
+    if (m_helloPending && type == "error" && obj.value("msg").toString().contains("hello")) {
+        // 旧版服务端不认识 hello: 保持 JSON, 不把错误显示给用户
+        m_helloPending = false;
+        return;
+    }
+    if (m_pingProbePending && type == "error" && obj.value("msg").toString().contains("ping")) {
+        // 旧版服务端不认识 ping: 停止心跳, 不把错误显示给用户, 也不按无响应断开
+        m_pingProbePending = false;
+        m_pingTimer->stop();
+        qDebug() << "[Network] 服务端不支持 ping, 已关闭心跳检测";
+        return;
+    }
+    if (type == "ack") {
+        trimSentLog(quint64(obj.value("received").toDouble()));
+        return;
+    }
+    if (type == "resume_result") {
+        onResumeResult(obj);
+        return;
+    }
+    if (type == "ping") {
+        sendJson(QJsonObject{{"type", "pong"}, {"t", obj.value("t")}});
+        return;
+    }
+    if (type == "pong") {
+        onPong(obj);
+        return;
+    }
+    if (m_resuming && type == "error" && obj.value("msg").toString().contains("resume")) {
+        // 旧版服务端不支持恢复会话
+        onResumeResult(QJsonObject{{"success", false}});
+        return;
+    }
+
+    // 业务消息计数, 定期回执以便服务端释放补发队列
+    ++m_recvCount;
+    if (!m_resumeToken.isEmpty() && m_recvCount - m_recvAcked >= kAckInterval) {
+        m_recvAcked = m_recvCount;
+        sendJson(QJsonObject{{"type", "ack"}, {"received", double(m_recvCount)}});
+    }
+    if (type == "login_result" && obj.value("success").toBool() && obj.contains("resume_token")) {
+        m_resumeToken = obj.value("resume_token").toString();
+        m_sentLog.clear();
+        m_sentBase = m_sentCount;
+    } else if (type == "logout_result") {
+        m_resumeToken.clear();
+        m_sentLog.clear();
+    }
 
     // 异步转发到事件队列, 避免在socket回调栈中直接处理业务逻辑, 防止重入崩溃
-    // QueuedConnection 会将参数安全地放入事件循环, 由 emitJsonReceived 槽函数处理
-    QMetaObject::invokeMethod(this, "emitJsonReceived", Qt::QueuedConnection, Q_ARG(QJsonObject, obj));
+    // 只经过这一次排队: 出队后直接调用该类型的订阅者, 类型在此处查表一次
+    const MessageDispatcher::Type mt = MessageDispatcher::typeOf(type);
+    QMetaObject::invokeMethod(this, [this, mt, obj]() { deliver(mt, obj); }, Qt::QueuedConnection);
 }
 
 
 void NetworkManager::onSocketDisconnected()
 {
-    emit logMessage(QStringLiteral("对方断开连接"));
     // 避免重复释放
     if (!m_socket) return;
     disconnect(m_socket, nullptr, this, nullptr);
     m_socket->deleteLater();
     m_socket = nullptr;
+    m_format = WireCodec::Json;
+    m_helloPending = false;
+    m_resuming = false;
+    m_pingTimer->stop();
+
+    // 已登录的客户端: 保留会话并自动重连
+    if (!m_isHosting && !m_resumeToken.isEmpty()) {
+        if (!m_reconnecting) {
+            m_reconnecting = true;
+            m_reconnectAttempt = 0;
+            m_reconnectClock.start();
+            emit logMessage(QStringLiteral("与服务器的连接中断, 正在重连..."));
+        }
+        scheduleReconnect();
+        return;
+    }
+
+    emit logMessage(QStringLiteral("对方断开连接"));
     emit disconnected();
 }
 
+void NetworkManager::scheduleReconnect()
+{
+    if (m_reconnectTimer->isActive()) return;
+    const int base = qMin(kReconnectMaxMs, kReconnectBaseMs << qMin(m_reconnectAttempt, 6));
+    // 在 [base/2, base] 内随机, 避免服务器重启后所有客户端同时重连
+    const int delay = base / 2 + int(QRandomGenerator::global()->bounded(base / 2 + 1));
+    if (m_reconnectClock.elapsed() + delay > kResumeWindowMs) {
+        emit logMessage(QStringLiteral("重连超时, 已断开"));
+        m_reconnecting = false;
+        resetSession();
+        emit disconnected();
+        return;
+    }
+    ++m_reconnectAttempt;
+    qDebug() << "[Network] 第" << m_reconnectAttempt << "次重连, 等待" << delay << "ms";
+    emit reconnecting(m_reconnectAttempt, delay);
+    m_reconnectTimer->start(delay);
+}
+
+void NetworkManager::onReconnectTimeout()
+{
+    if (!m_reconnecting) return;
+    emit logMessage(QStringLiteral("正在重连 (第 %1 次)...").arg(m_reconnectAttempt));
+    openSocket();
+}
+
+void NetworkManager::onResumeResult(const QJsonObject &obj)
+{
+    m_resuming = false;
+    if (!obj.value("success").toBool()) {
+        emit logMessage(QStringLiteral("会话已失效, 请重新登录"));
+        disconnectFromHost();
+        return;
+    }
+
+    m_reconnecting = false;
+    m_reconnectTimer->stop();
+    // 服务端未收到的消息 (含断线期间发出的) 按原顺序补发
+    trimSentLog(quint64(obj.value("received").toDouble()));
+    for (const QJsonObject &m : qAsConst(m_sentLog)) writeMessage(m);
+    // 服务端随后补发的消息会继续累加 m_recvCount, 这里先同步回执基准
+    m_recvAcked = m_recvCount;
+    qDebug() << "[Network] 会话已恢复, 补发" << m_sentLog.size() << "条";
+    emit logMessage(QStringLiteral("已恢复连接"));
+    emit resumed();
+}
+
+void NetworkManager::sendPing()
+{
+    if (!m_socket || m_socket->state() != QAbstractSocket::ConnectedState || m_resuming) return;
+    const qint64 now = m_clock.elapsed();
+    if (!m_pingSupported) {
+        // 尚不确定服务端是否支持: 只发一次试探, 等待 pong 或错误回复
+        if (m_pingProbePending) return;
+        m_pingProbePending = true;
+        sendJson(QJsonObject{{"type", "ping"}, {"t", double(now)}});
+        return;
+    }
+    if (now - m_lastPongMs > kPongTimeoutMs) {
+        // 半开连接: 底层迟迟不报告断开, 主动中止以进入重连流程
+        emit logMessage(QStringLiteral("服务器无响应, 重新连接"));
+        m_socket->abort();
+        return;
+    }
+    m_stats.queuedBytes = m_socket->bytesToWrite();
+    // 上报上一轮统计, 服务端据此记录网络状况并转告对手
+    sendJson(QJsonObject{{"type", "ping"}, {"t", double(now)},
+                         {"rtt", m_stats.rttMs}, {"jitter", m_stats.jitterMs},
+                         {"queue", double(m_stats.queuedBytes)}});
+}
+
+void NetworkManager::onPong(const QJsonObject &obj)
+{
+    const qint64 now = m_clock.elapsed();
+    m_lastPongMs = now;
+    m_pingSupported = true;
+    m_pingProbePending = false;
+    if (!obj.value("t").isDouble()) return;
+    const double sample = double(now) - obj.value("t").toDouble();
+    if (sample < 0) return;
+
+    // 与 TCP 相同的平滑方式: SRTT 权重 1/8, 偏差权重 1/4
+    if (m_srtt < 0) {
+        m_srtt = sample;
+        m_rttVar = sample / 2;
+    } else {
+        m_rttVar = 0.75 * m_rttVar + 0.25 * qAbs(m_srtt - sample);
+        m_srtt = 0.875 * m_srtt + 0.125 * sample;
+    }
+    m_stats.lastRttMs = qRound(sample);
+    m_stats.rttMs = qRound(m_srtt);
+    m_stats.jitterMs = qRound(m_rttVar);
+    if (m_socket) m_stats.queuedBytes = m_socket->bytesToWrite();
+    m_stats.peerRttMs = obj.value("peer_rtt").toInt(-1);
+    emit statsUpdated();
+}
+
+void NetworkManager::trimSentLog(quint64 received)
+{
+    while (!m_sentLog.isEmpty() && m_sentBase < received) {
+        m_sentLog.removeFirst();
+        ++m_sentBase;
+    }
+}
+
+void NetworkManager::resetSession()
+{
+    m_resumeToken.clear();
+    m_recvCount = m_recvAcked = 0;
+    m_sentCount = m_sentBase = 0;
+    m_sentLog.clear();
+    m_resuming = false;
+    m_srtt = -1.0;
+    m_rttVar = 0.0;
+    m_stats = NetworkStats();
+}
+
 void NetworkManager::sendJson(const QJsonObject &obj)
+{
+    const bool control = WireCodec::isControl(obj.value("type").toString());
+    if (!control && !m_isHosting) {
+        ++m_sentCount;
+        if (!m_resumeToken.isEmpty()) {
+            m_sentLog.append(obj);
+            if (m_sentLog.size() > kSentLogLimit) {
+                m_sentLog.removeFirst();
+                ++m_sentBase;
+            }
+        }
+    }
+    if (m_reconnecting) {
+        // 业务消息等会话恢复后从 m_sentLog 补发
+        if (control && m_socket) writeMessage(obj);
+        return;
+    }
+    writeMessage(obj);
+}
+
+void NetworkManager::writeMessage(const QJsonObject &obj)
 {
     if (!m_socket) {
         emit logMessage(QStringLiteral("发送失败: 未连接"));
         return;
     }
-    QJsonDocument doc(obj);
-    QString txt = QString::fromUtf8(doc.toJson(QJsonDocument::Compact));
-    m_socket->sendTextMessage(txt);
+    if (m_format == WireCodec::Cbor) {
+        m_socket->sendBinaryMessage(WireCodec::encode(obj, WireCodec::Cbor));
+    } else {
+        m_socket->sendTextMessage(QString::fromUtf8(WireCodec::encode(obj, WireCodec::Json)));
+    }
 }
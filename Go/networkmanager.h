@@ -5,7 +5,31 @@
 #include <QWebSocketServer>
 #include <QWebSocket>
 #include <QJsonObject>
+#include <QElapsedTimer>
+#include <QUrl>
+#include "wirecodec.h"
+#include "messagedispatcher.h"
 
+class QTimer;
+
+// 网络质量统计 (客户端模式), 由定期 ping/pong 得出
+struct NetworkStats {
+    int rttMs = -1;         // 平滑往返时延, -1 表示尚无样本
+    int jitterMs = 0;       // 往返时延的平滑平均偏差
+    int lastRttMs = -1;     // 最近一次样本
+    qint64 queuedBytes = 0; // 套接字中尚未写出的字节数
+    int peerRttMs = -1;     // 对手的平滑往返时延 (由服务端转告), -1 表示未知
+};
+
+/*
+ NetworkManager: 主机模式为单点对等连接, 客户端模式连接中央服务器
+  - 登录后服务端签发恢复令牌; 连接意外中断时按指数退避 (带随机抖动) 自动重连,
+    新连接上发送 resume 接管原会话, 服务端在宽限期内保留座位与房间
+  - 双方各自对业务消息按顺序计数并定期回执 (ack), 重连后只补发对方未收到的部分;
+    重连期间发出的消息先记入待确认队列, 恢复后按原顺序补发
+  - 每 2 秒发送 ping 测量往返时延, 并把上一轮统计随 ping 上报服务端;
+    长时间收不到 pong 视为半开连接, 主动断开以触发重连
+*/
 class NetworkManager : public QObject
 {
     Q_OBJECT
@@ -21,31 +45,91 @@ public:
     void connectToHost(const QUrl &url);
     void disconnectFromHost();
 
-    bool isConnected() const { return m_socket && m_socket->state() == QAbstractSocket::ConnectedState; }
+    // 自动重连期间也视为在线, 以免界面中途退出对局
+    bool isConnected() const { return (m_socket && m_socket->state() == QAbstractSocket::ConnectedState) || m_reconnecting; }
+    bool isReconnecting() const { return m_reconnecting; }
     bool isHosting() const { return m_isHosting; }
 
-    // 发送 JSON 对象 (序列化)
+    // 发送 JSON 对象 (按协商结果编码为 JSON 文本或 CBOR 二进制)
     void sendJson(const QJsonObject &obj);
+    WireCodec::Format wireFormat() const { return m_format; }
+    NetworkStats stats() const { return m_stats; }
+    // 按类型订阅收到的消息 (推荐); jsonReceived 信号仍会发出, 供尚未迁移的接收方使用
+    MessageDispatcher *dispatcher() { return &m_dispatcher; }
 
 signals:
     // 连接成功时触发 (主机接受客户端, 或客户端连接到主机时)
     void connected();
     void disconnected();
+    // 连接意外中断, 将在 delayMs 后进行第 attempt 次重连
+    void reconnecting(int attempt, int delayMs);
+    // 重连成功并恢复了原会话
+    void resumed();
+    // 收到 pong, 网络质量统计已更新
+    void statsUpdated();
     void jsonReceived(const QJsonObject &obj);
     void logMessage(const QString &msg);
 
 public slots:
+    // 把一条消息交给订阅者与 jsonReceived 的接收方
     void emitJsonReceived(const QJsonObject &obj);
 
 private slots:
     void onNewConnection();
     void onSocketTextMessageReceived(const QString &message);
+    void onSocketBinaryMessageReceived(const QByteArray &message);
     void onSocketDisconnected();
+    void onReconnectTimeout();
+    void sendPing();
 
 private:
+    // 解码后的公共处理: 协商消息在此消化, 其余转发给上层
+    void handleIncoming(const QByteArray &data, bool binary);
+    void sendHello();
+    // 创建套接字并连接 m_url
+    void openSocket();
+    // 按当前编码直接写入套接字
+    void writeMessage(const QJsonObject &obj);
+    void scheduleReconnect();
+    void onResumeResult(const QJsonObject &obj);
+    // 服务端确认已收到前 received 条消息
+    void trimSentLog(quint64 received);
+    void resetSession();
+    void onPong(const QJsonObject &obj);
+
     QWebSocketServer *m_server = nullptr;
     QWebSocket *m_socket = nullptr; // 本示例中为单点对等连接
     bool m_isHosting = false;
+    // 当前连接的发送编码; 每次建立连接时回到 JSON, 直到协商完成
+    WireCodec::Format m_format = WireCodec::Json;
+    bool m_helloPending = false;
+    MessageDispatcher m_dispatcher;
+    void deliver(MessageDispatcher::Type type, const QJsonObject &obj);
+
+    // 会话恢复 (仅客户端模式)
+    QUrl m_url;
+    QString m_resumeToken;
+    quint64 m_recvCount = 0;      // 已收到的业务消息数
+    quint64 m_recvAcked = 0;      // 上次回执时的 m_recvCount
+    quint64 m_sentCount = 0;      // 已发出 (含待补发) 的业务消息数
+    quint64 m_sentBase = 0;       // m_sentLog 首条消息的序号
+    QList<QJsonObject> m_sentLog; // 服务端尚未确认的消息
+    QTimer *m_reconnectTimer = nullptr;
+    QElapsedTimer m_reconnectClock; // 本轮断线开始计时, 超出重连窗口后放弃
+    int m_reconnectAttempt = 0;
+    bool m_reconnecting = false;  // 已断线, 会话尚未恢复
+    bool m_resuming = false;      // 新连接已建立, 等待 resume_result
+
+    // 网络质量
+    QTimer *m_pingTimer = nullptr;
+    QElapsedTimer m_clock;        // ping 时间戳的单调时钟
+    qint64 m_lastPongMs = 0;
+    // 服务端回过 hello_ack 或 pong 才算支持 ping; 此前只发一次试探, 不做超时判断
+    bool m_pingSupported = false;
+    bool m_pingProbePending = false;
+    double m_srtt = -1.0;
+    double m_rttVar = 0.0;
+    NetworkStats m_stats;
 };
 
 #endif // NETWORKMANAGER_H```
@@ -0,0 +1,325 @@
+#include "observationview.h"
+#include "networkmanager.h"
+#include "stonespritecache.h"
+
+#include <QPainter>
+#include <QPaintEvent>
+#include <QScrollBar>
+#include <QTimer>
+#include <QtMath>
+#include <QDebug>
+
+namespace {
+const int kTitleHeight = 18;
+const int kTileMargin = 6;
+}
+
+ObservationView::ObservationView(NetworkManager *net, QWidget *parent)
+    : QAbstractScrollArea(parent),
+      m_net(net),
+      m_repaintTimer(new QTimer(this))
+{
+    setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    viewport()->setAttribute(Qt::WA_OpaquePaintEvent);
+
+    // 约 30 帧/秒: 两次刷新之间到达的所有落子合并为一次重绘
+    m_repaintTimer->setSingleShot(true);
+    m_repaintTimer->setInterval(33);
+    connect(m_repaintTimer, &QTimer::timeout, this, &ObservationView::flushDirty);
+
+    if (m_net) {
+        using Msg = MessageDispatcher;
+        m_net->dispatcher()->subscribe(
+            {Msg::Move, Msg::Pass, Msg::Delta, Msg::Sync, Msg::Start, Msg::NewGame, Msg::RoomClosed, Msg::SpectateResult},
+            this, [this](Msg::Type t, const QJsonObject &obj) { onNetworkMessage(t, obj); });
+    }
+}
+
+ObservationView::~ObservationView()
+{
+    for (ObservedBoard *b : qAsConst(m_boards)) {
+        if (m_net && m_net->isConnected() && !b->closed) {
+            m_net->sendJson(QJsonObject{{"type", "unspectate"}, {"room_id", b->roomId}});
+        }
+        delete b;
+    }
+}
+
+void ObservationView::observe(const QString &roomId, const QString &title)
+{
+    if (roomId.isEmpty() || m_index.contains(roomId)) return;
+    ObservedBoard *b = new ObservedBoard;
+    b->roomId = roomId;
+    b->title = title.isEmpty() ? tr("房间 %1").arg(roomId) : title;
+    m_index.insert(roomId, m_boards.size());
+    m_boards.append(b);
+
+    if (m_net && m_net->isConnected()) {
+        // 服务端收到后会让对局方发送一次全量盘面
+        m_net->sendJson(QJsonObject{{"type", "spectate"}, {"room_id", roomId}});
+        b->resyncPending = true;
+    }
+    updateScrollRange();
+    markDirty(m_boards.size() - 1);
+}
+
+void ObservationView::unobserve(const QString &roomId)
+{
+    auto it = m_index.find(roomId);
+    if (it == m_index.end()) return;
+    int idx = it.value();
+    ObservedBoard *b = m_boards.takeAt(idx);
+    if (m_net && m_net->isConnected() && !b->closed) {
+        m_net->sendJson(QJsonObject{{"type", "unspectate"}, {"room_id", roomId}});
+    }
+    delete b;
+
+    // 之后的格子整体前移
+    m_index.clear();
+    for (int k = 0; k < m_boards.size(); ++k) m_index.insert(m_boards[k]->roomId, k);
+    m_dirty.clear();
+    updateScrollRange();
+    viewport()->update();
+}
+
+void ObservationView::setTileSize(int size)
+{
+    m_tileSize = qMax(80, size);
+    updateScrollRange();
+    viewport()->update();
+}
+
+void ObservationView::setRepaintInterval(int ms)
+{
+    m_repaintTimer->setInterval(qMax(0, ms));
+}
+
+void ObservationView::onNetworkMessage(MessageDispatcher::Type t, const QJsonObject &obj)
+{
+    using Msg = MessageDispatcher;
+    QString rid = obj.value("room_id").toString();
+    auto it = m_index.constFind(rid);
+    if (it == m_index.constEnd()) return;
+    const int idx = it.value();
+    ObservedBoard *b = m_boards[idx];
+
+    if (t == Msg::Move) {
+        int i = -1, j = -1;
+        if (obj.contains("i") && obj.contains("j")) {
+            i = obj.value("i").toInt();
+            j = obj.value("j").toInt();
+        } else if (obj.contains("x") && obj.contains("y")) {
+            i = obj.value("x").toInt();
+            j = obj.value("y").toInt();
+        }
+        if (i >= 0 && j >= 0 && b->goban.play(i, j)) ++b->moves;
+    } else if (t == Msg::Pass) {
+        b->goban.pass();
+        ++b->moves;
+    } else if (t == Msg::Delta) {
+        quint32 seq = quint32(obj.value("seq").toDouble());
+        if (seq <= b->seq) return;
+        if (seq != b->seq + 1) {
+            requestResync(b);
+            return;
+        }
+        int x = obj.value("x").toInt(-1), y = obj.value("y").toInt(-1);
+        int next = obj.value("next").toInt();
+        if (next == 1 || next == 2) b->goban.setCurrentPlayer(3 - next);
+        bool ok = true;
+        if (x < 0 || y < 0) b->goban.pass();
+        else ok = b->goban.play(x, y);
+        if (!ok || QString::number(b->goban.hash(), 16) != obj.value("hash").toString()) {
+            requestResync(b);
+            if (!ok) return;
+        }
+        b->seq = seq;
+        ++b->moves;
+    } else if (t == Msg::Sync) {
+        bool ok = obj.contains("packed")
+                ? b->goban.unpackBoard(QByteArray::fromBase64(obj.value("packed").toString().toLatin1()))
+                : b->goban.deserialize(obj.value("board").toString().toStdString());
+        if (ok) {
+            int cur = obj.value("currentPlayer").toInt();
+            if (cur == 1 || cur == 2) b->goban.setCurrentPlayer(cur);
+            if (obj.contains("seq")) {
+                b->seq = quint32(obj.value("seq").toDouble());
+                b->moves = int(b->seq);
+            }
+            b->resyncPending = false;
+        }
+    } else if (t == Msg::Start || t == Msg::NewGame) {
+        b->goban.reset();
+        b->moves = 0;
+        b->seq = 0;
+        b->closed = false;
+    } else if (t == Msg::RoomClosed || (t == Msg::SpectateResult && !obj.value("success").toBool())) {
+        b->closed = true;
+    } else {
+        return;
+    }
+    markDirty(idx);
+}
+
+void ObservationView::requestResync(ObservedBoard *b)
+{
+    if (b->resyncPending || b->closed || !m_net || !m_net->isConnected()) return;
+    b->resyncPending = true;
+    m_net->sendJson(QJsonObject{{"type", "resync_request"}, {"room_id", b->roomId}});
+}
+
+void ObservationView::markDirty(int index)
+{
+    m_dirty.insert(index);
+    if (!m_repaintTimer->isActive()) m_repaintTimer->start();
+}
+
+void ObservationView::flushDirty()
+{
+    // 滚出视口的格子直接丢弃, 滚回来时按最新数据绘制
+    const QRect visible = viewport()->rect();
+    QRegion region;
+    for (int idx : qAsConst(m_dirty)) {
+        QRect r = tileRect(idx);
+        if (r.intersects(visible)) region += r;
+    }
+    m_dirty.clear();
+    if (!region.isEmpty()) viewport()->update(region);
+}
+
+int ObservationView::columns() const
+{
+    return qMax(1, viewport()->width() / m_tileSize);
+}
+
+QRect ObservationView::tileRect(int index) const
+{
+    int cols = columns();
+    int x = (index % cols) * m_tileSize;
+    int y = (index / cols) * m_tileSize - verticalScrollBar()->value();
+    return QRect(x, y, m_tileSize, m_tileSize);
+}
+
+QRect ObservationView::boardRectIn(const QRect &tile) const
+{
+    QRect area = tile.adjusted(kTileMargin, kTitleHeight, -kTileMargin, -kTileMargin);
+    int side = qMin(area.width(), area.height());
+    return QRect(area.x() + (area.width() - side) / 2, area.y(), side, side);
+}
+
+void ObservationView::updateScrollRange()
+{
+    int cols = columns();
+    int rows = (m_boards.size() + cols - 1) / cols;
+    int total = rows * m_tileSize;
+    QScrollBar *bar = verticalScrollBar();
+    bar->setRange(0, qMax(0, total - viewport()->height()));
+    bar->setPageStep(viewport()->height());
+    bar->setSingleStep(m_tileSize / 4);
+}
+
+void ObservationView::resizeEvent(QResizeEvent *event)
+{
+    QAbstractScrollArea::resizeEvent(event);
+    updateScrollRange();
+}
+
+void ObservationView::scrollContentsBy(int dx, int dy)
+{
+    // 已绘制的部分直接平移, 只有新露出的区域需要重绘
+    viewport()->scroll(dx, dy);
+}
+
+const QPixmap &ObservationView::boardLayer(int n, int gridSize, qreal dpr)
+{
+    if (!m_boardLayer.isNull() && m_layerN == n && m_layerGrid == gridSize && m_boardLayer.devicePixelRatioF() == dpr) {
+        return m_boardLayer;
+    }
+    m_layerN = n;
+    m_layerGrid = gridSize;
+    const int pad = gridSize / 2 + 2;
+    const int side = gridSize * (n - 1) + 2 * pad;
+    m_boardLayer = QPixmap(qCeil(side * dpr), qCeil(side * dpr));
+    m_boardLayer.setDevicePixelRatio(dpr);
+    m_boardLayer.fill(QColor(238, 207, 161));
+
+    QPainter p(&m_boardLayer);
+    p.setPen(Qt::black);
+    const int len = gridSize * (n - 1);
+    for (int k = 0; k < n; ++k) {
+        p.drawLine(pad, pad + k*gridSize, pad + len, pad + k*gridSize);
+        p.drawLine(pad + k*gridSize, pad, pad + k*gridSize, pad + len);
+    }
+    if (n == 19) {
+        p.setRenderHint(QPainter::Antialiasing, true);
+        p.setBrush(Qt::black);
+        int coords[] = {3, 9, 15};
+        for (int a : coords)
+            for (int c : coords)
+                p.drawEllipse(QPoint(pad + a*gridSize, pad + c*gridSize), 2, 2);
+    }
+    return m_boardLayer;
+}
+
+void ObservationView::drawTile(QPainter &p, const ObservedBoard &b, const QRect &tile, qreal dpr)
+{
+    // 标题: 房间与手数
+    QString title = b.closed ? tr("%1 (已结束)").arg(b.title) : tr("%1  第 %2 手").arg(b.title).arg(b.moves);
+    p.setPen(palette().color(QPalette::WindowText));
+    p.drawText(QRect(tile.x() + kTileMargin, tile.y(), tile.width() - 2*kTileMargin, kTitleHeight),
+               Qt::AlignLeft | Qt::AlignVCenter, title);
+
+    const int n = b.goban.size();
+    if (n < 2) return;
+    const QRect area = boardRectIn(tile);
+    const int gridSize = (area.width() - 4) / n;
+    if (gridSize < 2) return;
+    const int pad = gridSize / 2 + 2;
+
+    const QPixmap &layer = boardLayer(n, gridSize, dpr);
+    const QPoint origin(area.x() + (area.width() - qRound(layer.width() / dpr)) / 2, area.y());
+    p.drawPixmap(origin, layer);
+
+    const int radius = qMax(1, gridSize / 2 - 1);
+    const QPixmap &black = StoneSpriteCache::sprite(1, radius, dpr);
+    const QPixmap &white = StoneSpriteCache::sprite(2, radius, dpr);
+    const QPoint offset = StoneSpriteCache::offset(radius);
+    for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < n; ++j) {
+            int v = b.goban.get(i, j);
+            if (v == 0) continue;
+            p.drawPixmap(origin + QPoint(pad + j*gridSize, pad + i*gridSize) + offset, v == 1 ? black : white);
+        }
+    }
+
+    // 最后一手标记
+    auto last = b.goban.lastMove();
+    if (last.first >= 0) {
+        p.fillRect(QRect(origin + QPoint(pad + last.second*gridSize - 1, pad + last.first*gridSize - 1), QSize(3, 3)),
+                   QColor(220, 0, 0));
+    }
+}
+
+void ObservationView::paintEvent(QPaintEvent *event)
+{
+    QPainter p(viewport());
+    const QRect dirty = event->rect();
+    p.fillRect(dirty, palette().color(QPalette::Window));
+    if (m_boards.isEmpty()) return;
+
+    // 只遍历与重绘区域相交的行
+    const int cols = columns();
+    const int scroll = verticalScrollBar()->value();
+    const int firstRow = qMax(0, (dirty.top() + scroll) / m_tileSize);
+    const int lastRow = (dirty.bottom() + scroll) / m_tileSize;
+    const qreal dpr = viewport()->devicePixelRatioF();
+    for (int row = firstRow; row <= lastRow; ++row) {
+        for (int col = 0; col < cols; ++col) {
+            int idx = row * cols + col;
+            if (idx >= m_boards.size()) return;
+            QRect tile = tileRect(idx);
+            if (!event->region().intersects(tile)) continue;
+            drawTile(p, *m_boards[idx], tile, dpr);
+        }
+    }
+}
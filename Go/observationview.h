@@ -0,0 +1,85 @@
+#ifndef OBSERVATIONVIEW_H
+#define OBSERVATIONVIEW_H
+
+#include <QAbstractScrollArea>
+#include <QVector>
+#include <QHash>
+#include <QSet>
+#include <QPixmap>
+#include <QJsonObject>
+#include "goban.h"
+#include "messagedispatcher.h"
+
+class NetworkManager;
+class QTimer;
+
+/*
+ ObservationView: 同时观战多盘对局的网格视图
+  - 所有棋盘画在同一个视口里, 每盘棋只是一个轻量的 Goban, 没有独立的控件与网络连接
+  - 棋盘底图 (背景/网格/星位) 所有格子共用一张, 棋子使用 StoneSpriteCache 的共享贴图
+  - 网络消息只更新数据并标记脏格子, 由一个定时器合并后统一重绘
+  - 只重绘与视口相交的格子, 滚出视口的棋盘不产生任何绘制开销
+*/
+class ObservationView : public QAbstractScrollArea
+{
+    Q_OBJECT
+public:
+    explicit ObservationView(NetworkManager *net, QWidget *parent = nullptr);
+    ~ObservationView();
+
+    // 开始/停止观战某个房间
+    void observe(const QString &roomId, const QString &title = QString());
+    void unobserve(const QString &roomId);
+    int boardCount() const { return m_boards.size(); }
+
+    // 每个格子的边长 (逻辑像素)
+    void setTileSize(int size);
+    // 合并重绘的间隔 (毫秒)
+    void setRepaintInterval(int ms);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void scrollContentsBy(int dx, int dy) override;
+
+private slots:
+    void flushDirty();
+
+private:
+    void onNetworkMessage(MessageDispatcher::Type t, const QJsonObject &obj);
+
+    struct ObservedBoard {
+        QString roomId;
+        QString title;
+        Goban goban;
+        int moves = 0;
+        bool closed = false;
+        quint32 seq = 0;            // 最后应用的增量序号
+        bool resyncPending = false;
+    };
+
+    void markDirty(int index);
+    // 增量序号跳变/校验失败, 或刚开始观战时, 请求对局方发送全量盘面
+    void requestResync(ObservedBoard *b);
+    void updateScrollRange();
+    int columns() const;
+    // 第 index 个格子在视口中的位置 (已减去滚动偏移)
+    QRect tileRect(int index) const;
+    QRect boardRectIn(const QRect &tile) const;
+    void drawTile(QPainter &p, const ObservedBoard &b, const QRect &tile, qreal dpr);
+    const QPixmap &boardLayer(int n, int gridSize, qreal dpr);
+
+    NetworkManager *m_net;
+    QVector<ObservedBoard *> m_boards;
+    QHash<QString, int> m_index; // room_id -> m_boards 下标
+    QSet<int> m_dirty;
+    QTimer *m_repaintTimer;
+    int m_tileSize = 240;
+
+    // 共享的棋盘底图及其参数
+    QPixmap m_boardLayer;
+    int m_layerN = 0;
+    int m_layerGrid = 0;
+};
+
+#endif // OBSERVATIONVIEW_H
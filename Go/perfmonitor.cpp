@@ -0,0 +1,132 @@
+#include "perfmonitor.h"
+
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+#include <QCoreApplication>
+#include <QStringList>
+#include <QDebug>
+
+namespace {
+// 原始事件上限 (约 5MB), 写满后覆盖最旧的事件
+const size_t kMaxEvents = 200000;
+const int kHeartbeatMs = 4;
+}
+
+bool PerfMonitor::s_enabled = qEnvironmentVariableIntValue("GOQT_PERF") > 0;
+
+PerfMonitor::PerfMonitor(QObject *parent)
+    : QObject(parent)
+{
+    m_events.reserve(kMaxEvents);
+}
+
+PerfMonitor *PerfMonitor::instance()
+{
+    static PerfMonitor *inst = new PerfMonitor(QCoreApplication::instance());
+    return inst;
+}
+
+qint64 PerfMonitor::nowUs()
+{
+    static QElapsedTimer clock = []() { QElapsedTimer t; t.start(); return t; }();
+    return clock.nsecsElapsed() / 1000;
+}
+
+void PerfMonitor::record(Metric metric, qint64 startUs)
+{
+    if (!s_enabled) return;
+    instance()->addEvent(metric, startUs, nowUs() - startUs);
+}
+
+const char *PerfMonitor::metricName(Metric metric)
+{
+    switch (metric) {
+    case Paint: return "paint";
+    case AiMove: return "ai_move";
+    case NetMessage: return "net_message";
+    case Stall: return "stall";
+    default: return "unknown";
+    }
+}
+
+void PerfMonitor::addEvent(Metric metric, qint64 startUs, qint64 durationUs)
+{
+    m_histograms[metric].record(durationUs);
+    Event ev{startUs, durationUs, metric};
+    if (m_events.size() < kMaxEvents) {
+        m_events.push_back(ev);
+    } else {
+        m_events[m_nextEvent] = ev;
+        m_wrapped = true;
+    }
+    m_nextEvent = (m_nextEvent + 1) % kMaxEvents;
+}
+
+void PerfMonitor::reset()
+{
+    for (LatencyHistogram &h : m_histograms) h.clear();
+    m_events.clear();
+    m_nextEvent = 0;
+    m_wrapped = false;
+}
+
+void PerfMonitor::startStallDetector(int thresholdMs)
+{
+    m_stallThresholdUs = qMax(1, thresholdMs) * 1000;
+    if (!m_heartbeat) {
+        m_heartbeat = new QTimer(this);
+        m_heartbeat->setTimerType(Qt::PreciseTimer);
+        m_heartbeat->setInterval(kHeartbeatMs);
+        connect(m_heartbeat, &QTimer::timeout, this, &PerfMonitor::onHeartbeat);
+    }
+    m_lastBeatUs = nowUs();
+    m_heartbeat->start();
+}
+
+void PerfMonitor::onHeartbeat()
+{
+    // 心跳迟到的部分即事件循环被占用的时间
+    qint64 now = nowUs();
+    qint64 late = now - m_lastBeatUs - kHeartbeatMs * 1000;
+    if (late > m_stallThresholdUs) addEvent(Stall, m_lastBeatUs + kHeartbeatMs * 1000, late);
+    m_lastBeatUs = now;
+}
+
+QString PerfMonitor::summary() const
+{
+    const char *labels[MetricCount] = { "绘制", "AI", "网络", "卡顿" };
+    QStringList rows;
+    for (int m = 0; m < MetricCount; ++m) {
+        const LatencyHistogram &h = m_histograms[m];
+        if (h.count() == 0) continue;
+        rows << QString("%1 %2").arg(QString::fromUtf8(labels[m]), h.summary());
+    }
+    return rows.isEmpty() ? QStringLiteral("暂无数据") : rows.join('\n');
+}
+
+bool PerfMonitor::writeChromeTrace(const QString &path) const
+{
+    QFile f(path);
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        qWarning() << "[PerfMonitor] 无法写入" << path << ":" << f.errorString();
+        return false;
+    }
+    // 逐条写出, 不构造 QJsonDocument, 避免数十万个对象的临时分配
+    QTextStream out(&f);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    const qint64 pid = QCoreApplication::applicationPid();
+    const size_t n = m_events.size();
+    const size_t first = m_wrapped ? m_nextEvent : 0;
+    for (size_t k = 0; k < n; ++k) {
+        const Event &ev = m_events[(first + k) % n];
+        if (k) out << ",\n";
+        out << "{\"name\":\"" << metricName(ev.metric) << "\",\"cat\":\"goqt\",\"ph\":\"X\",\"ts\":" << ev.startUs
+            << ",\"dur\":" << ev.durationUs << ",\"pid\":" << pid << ",\"tid\":1}";
+    }
+    out << "\n]}\n";
+    out.flush();
+    qInfo().noquote() << QString("[PerfMonitor] 已导出 %1 个事件到 %2").arg(n).arg(path);
+    return f.error() == QFileDevice::NoError;
+}
@@ -0,0 +1,89 @@
+#ifndef PERFMONITOR_H
+#define PERFMONITOR_H
+
+#include <QObject>
+#include <QString>
+#include <vector>
+#include "latencyhistogram.h"
+
+class QTimer;
+
+/*
+ PerfMonitor: 客户端性能埋点 (设置环境变量 GOQT_PERF=1 开启)
+  - 记录棋盘绘制、AI 落子、网络消息处理的耗时, 以及主线程事件循环超过 16ms 的卡顿
+  - 每个指标一个 LatencyHistogram, 原始事件存入定长环形缓冲区, 可导出为 Chrome trace JSON
+    (chrome://tracing 或 ui.perfetto.dev 打开)
+  - 未开启时埋点只有一次布尔判断, 不取时间也不分配内存
+  - 仅在主线程使用
+*/
+class PerfMonitor : public QObject
+{
+    Q_OBJECT
+public:
+    enum Metric {
+        Paint,       // BoardWidget::paintEvent
+        AiMove,      // 从轮到 AI 到给出落子
+        NetMessage,  // NetworkManager 处理一条收到的消息
+        Stall,       // 事件循环卡顿
+        MetricCount
+    };
+
+    static bool isEnabled() { return s_enabled; }
+    static PerfMonitor *instance();
+    // 单调时钟 (微秒)
+    static qint64 nowUs();
+    // 记录一次从 startUs 到现在的耗时
+    static void record(Metric metric, qint64 startUs);
+    static const char *metricName(Metric metric);
+
+    void addEvent(Metric metric, qint64 startUs, qint64 durationUs);
+    const LatencyHistogram &histogram(Metric metric) const { return m_histograms[metric]; }
+    void reset();
+
+    // 事件循环心跳: 两次心跳的间隔比预期多出 thresholdMs 以上时记为一次卡顿
+    void startStallDetector(int thresholdMs = 16);
+    // 多行摘要, 用于悬浮面板
+    QString summary() const;
+    bool writeChromeTrace(const QString &path) const;
+
+private slots:
+    void onHeartbeat();
+
+private:
+    explicit PerfMonitor(QObject *parent = nullptr);
+
+    struct Event {
+        qint64 startUs;
+        qint64 durationUs;
+        Metric metric;
+    };
+
+    static bool s_enabled;
+
+    LatencyHistogram m_histograms[MetricCount];
+    std::vector<Event> m_events; // 环形缓冲区
+    size_t m_nextEvent = 0;
+    bool m_wrapped = false;
+
+    QTimer *m_heartbeat = nullptr;
+    qint64 m_lastBeatUs = 0;
+    int m_stallThresholdUs = 16000;
+};
+
+/*
+ PerfScope: 作用域计时, 析构时记录一次耗时
+*/
+class PerfScope
+{
+public:
+    explicit PerfScope(PerfMonitor::Metric metric)
+        : m_metric(metric), m_startUs(PerfMonitor::isEnabled() ? PerfMonitor::nowUs() : -1) {}
+    ~PerfScope() { if (m_startUs >= 0) PerfMonitor::record(m_metric, m_startUs); }
+
+private:
+    Q_DISABLE_COPY(PerfScope)
+    PerfMonitor::Metric m_metric;
+    qint64 m_startUs;
+};
+
+#endif // PERFMONITOR_H
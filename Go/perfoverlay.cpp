@@ -0,0 +1,45 @@
+#include "perfoverlay.h"
+#include "perfmonitor.h"
+
+#include <QTimer>
+#include <QShortcut>
+#include <QDateTime>
+#include <QDir>
+#include <QStandardPaths>
+#include <QFontDatabase>
+
+PerfOverlay::PerfOverlay(QWidget *target)
+    : QLabel(target),
+      m_timer(new QTimer(this))
+{
+    setAttribute(Qt::WA_TransparentForMouseEvents);
+    setAutoFillBackground(true);
+    QPalette pal = palette();
+    pal.setColor(QPalette::Window, QColor(30, 30, 30));
+    pal.setColor(QPalette::WindowText, QColor(0, 230, 0));
+    setPalette(pal);
+    setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    setMargin(4);
+    move(0, 0);
+
+    QShortcut *dump = new QShortcut(QKeySequence(Qt::CTRL | Qt::SHIFT | Qt::Key_T), target->window());
+    connect(dump, &QShortcut::activated, this, [this]() { dumpTrace(); });
+
+    connect(m_timer, &QTimer::timeout, this, &PerfOverlay::refresh);
+    m_timer->start(500);
+    refresh();
+}
+
+QString PerfOverlay::dumpTrace()
+{
+    QString path = QDir(QStandardPaths::writableLocation(QStandardPaths::TempLocation))
+            .filePath(QString("goqt_trace_%1.json").arg(QDateTime::currentDateTime().toString("yyyyMMdd_hhmmss")));
+    return PerfMonitor::instance()->writeChromeTrace(path) ? path : QString();
+}
+
+void PerfOverlay::refresh()
+{
+    setText(PerfMonitor::instance()->summary());
+    adjustSize();
+    raise();
+}
@@ -0,0 +1,30 @@
+#ifndef PERFOVERLAY_H
+#define PERFOVERLAY_H
+
+#include <QLabel>
+
+class QTimer;
+
+/*
+ PerfOverlay: 悬浮在目标控件左上角的性能面板 (仅在 GOQT_PERF 开启时创建)
+  - 每 500ms 刷新一次 PerfMonitor 的摘要
+  - 不透明背景, 刷新时不会引起下方棋盘重绘; 不接收鼠标事件
+  - Ctrl+Shift+T 导出 Chrome trace 到临时目录
+*/
+class PerfOverlay : public QLabel
+{
+    Q_OBJECT
+public:
+    explicit PerfOverlay(QWidget *target);
+
+    // 导出 trace, 返回文件路径 (失败返回空)
+    QString dumpTrace();
+
+private slots:
+    void refresh();
+
+private:
+    QTimer *m_timer;
+};
+
+#endif // PERFOVERLAY_H
@@ -0,0 +1,104 @@
+#include "replaymodel.h"
+#include "goban.h"
+
+#include <QtGlobal>
+#include <QDebug>
+
+ReplayModel::ReplayModel(int checkpointInterval)
+    : m_interval(qMax(1, checkpointInterval))
+{
+}
+
+void ReplayModel::clear()
+{
+    m_deltas.clear();
+    m_checkpoints.clear();
+    m_board.clear();
+    m_pos = 0;
+}
+
+void ReplayModel::load(const Goban &goban)
+{
+    clear();
+    m_n = goban.size();
+    const auto &history = goban.getMoveHistory();
+    m_deltas.reserve(history.size());
+    m_checkpoints.reserve(history.size() / size_t(m_interval) + 1);
+
+    Goban replay(m_n);
+    m_checkpoints.push_back(replay.serialize());
+    for (const auto &mv : history) {
+        const auto &pos = mv.first;
+        int color = mv.second;
+        replay.setCurrentPlayer(color);
+        if (!replay.play(pos.first, pos.second)) {
+            // 历史中不含虚着, 劫争判断可能误判; 清掉劫争记录后重试
+            replay.deserialize(replay.serialize());
+            replay.setCurrentPlayer(color);
+            if (!replay.play(pos.first, pos.second)) {
+                qDebug() << "[ReplayModel] 无法重放第" << m_deltas.size() + 1 << "手, 截断";
+                break;
+            }
+        }
+
+        Delta d;
+        d.point = pos.first * m_n + pos.second;
+        d.color = char('0' + color);
+        d.captured.reserve(replay.lastCaptures().size());
+        for (const auto &c : replay.lastCaptures()) d.captured.push_back(c.first * m_n + c.second);
+        m_deltas.push_back(std::move(d));
+
+        if (m_deltas.size() % size_t(m_interval) == 0) m_checkpoints.push_back(replay.serialize());
+    }
+
+    m_board = replay.serialize();
+    m_pos = moveCount();
+}
+
+void ReplayModel::stepForward()
+{
+    const Delta &d = m_deltas[size_t(m_pos)];
+    m_board[size_t(d.point)] = d.color;
+    for (int c : d.captured) m_board[size_t(c)] = '0';
+    ++m_pos;
+}
+
+void ReplayModel::stepBackward()
+{
+    --m_pos;
+    const Delta &d = m_deltas[size_t(m_pos)];
+    const char opp = (d.color == '1') ? '2' : '1';
+    m_board[size_t(d.point)] = '0';
+    for (int c : d.captured) m_board[size_t(c)] = opp;
+}
+
+int ReplayModel::seek(int index)
+{
+    if (m_board.empty()) return 0;
+    index = qBound(0, index, moveCount());
+
+    // 从最近的快照前进的代价为 index % K, 与逐手移动比较取小者
+    const int fromCurrent = qAbs(index - m_pos);
+    const int fromCheckpoint = index % m_interval;
+    int steps = 0;
+    if (fromCheckpoint < fromCurrent) {
+        m_board = m_checkpoints[size_t(index / m_interval)];
+        m_pos = index - fromCheckpoint;
+    }
+    while (m_pos < index) { stepForward(); ++steps; }
+    while (m_pos > index) { stepBackward(); ++steps; }
+    return steps;
+}
+
+std::pair<int,int> ReplayModel::lastMove() const
+{
+    if (m_pos <= 0) return {-1, -1};
+    int p = m_deltas[size_t(m_pos - 1)].point;
+    return {p / m_n, p % m_n};
+}
+
+int ReplayModel::toPlay() const
+{
+    if (m_pos <= 0) return 1;
+    return m_deltas[size_t(m_pos - 1)].color == '1' ? 2 : 1;
+}
@@ -0,0 +1,60 @@
+#ifndef REPLAYMODEL_H
+#define REPLAYMODEL_H
+
+#include <string>
+#include <vector>
+#include <utility>
+
+class Goban;
+
+/*
+ ReplayModel: 棋谱回放与跳转
+  - 加载时重放一遍落子历史, 记录每一手的增量 (落子点与被提的子), 并每隔 K 手保存一份盘面快照
+  - 跳转到任意手数时, 在 "从当前位置逐手前进/后退" 与 "从最近的快照前进" 中选代价小的一种,
+    最多应用 K 个增量, 不需要从第 0 手重放, 也不做规则判断
+  - 拖动进度条时相邻两次跳转通常只差几手, 代价与移动的手数成正比
+  - 盘面格式与 Goban::serialize 相同 ('0' 空, '1' 黑, '2' 白)
+*/
+class ReplayModel
+{
+public:
+    explicit ReplayModel(int checkpointInterval = 16);
+
+    // 以 goban 的落子历史重建 (不含虚着); 当前位置设为最后一手
+    void load(const Goban &goban);
+    void clear();
+
+    int boardSize() const { return m_n; }
+    // 手数; 可跳转的位置为 0..moveCount()
+    int moveCount() const { return int(m_deltas.size()); }
+    int position() const { return m_pos; }
+
+    // 跳转到第 index 手之后的局面, 返回实际应用的增量数
+    int seek(int index);
+
+    const std::string &board() const { return m_board; }
+    int get(int i, int j) const { return m_board[size_t(i * m_n + j)] - '0'; }
+    // 当前局面的最后一手, 第 0 手为 (-1,-1)
+    std::pair<int,int> lastMove() const;
+    // 当前局面轮到哪方
+    int toPlay() const;
+
+private:
+    struct Delta {
+        int point;            // 落子点 (i*n + j)
+        char color;           // '1' 或 '2'
+        std::vector<int> captured; // 被提掉的对方棋子
+    };
+
+    void stepForward();
+    void stepBackward();
+
+    int m_interval;
+    int m_n = 19;
+    std::vector<Delta> m_deltas;
+    std::vector<std::string> m_checkpoints; // m_checkpoints[k] 为第 k*K 手之后的盘面
+    std::string m_board;
+    int m_pos = 0;
+};
+
+#endif // REPLAYMODEL_H
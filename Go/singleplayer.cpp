@@ -1,15 +1,13 @@
 #include "singleplayer.h"
 #include "boardwidget.h"
 #include "ai_random.h"
+#include "engineconnection.h"
+#include "analysisservice.h"
+#include "perfmonitor.h"
 
 #include <QTimer>
 #include <QDebug>
-#include <QProcess>
-#include <QCoreApplication>
-#include <QDir>
-#include <QFile>
 #include <QJsonDocument>
-#include <QJsonParseError>
 #include <QJsonObject>
 #include <QJsonArray>
 #include <random>
@@ -22,8 +20,7 @@ SinglePlayerManager::SinglePlayerManager(QObject *parent)
       m_aiLevel(0),
       m_running(false),
       m_timer(new QTimer(this)),
-      m_kataGoProcess(nullptr),
-      m_kataGoBuffer()
+      m_engine(nullptr)
 {
     m_timer->setSingleShot(true);
     connect(m_timer, &QTimer::timeout, this, &SinglePlayerManager::onTimerTimeout);
@@ -54,68 +51,39 @@ void SinglePlayerManager::start(int aiColor, int level)
     m_aiLevel = qBound(0, level, 2);
     m_running = true;
 
-    if (m_aiLevel == 2) {
-        if (!m_kataGoProcess) {
-            m_kataGoProcess = new QProcess(this);
-            connect(m_kataGoProcess, &QProcess::readyReadStandardOutput, this, &SinglePlayerManager::onKataGoReadyRead);
-            connect(m_kataGoProcess, &QProcess::errorOccurred, this, &SinglePlayerManager::onKataGoError);
-            m_kataGoProcess->setProcessChannelMode(QProcess::MergedChannels);
-        }
-
-        if (m_kataGoProcess->state() != QProcess::NotRunning) {
-            m_kataGoProcess->kill();
-            m_kataGoProcess->waitForFinished();
-        }
-
-        QString appDir = QCoreApplication::applicationDirPath();
-        QString kataGoDir = appDir + "/katago/";
-        QDir dir(kataGoDir);
-
-        if (!dir.exists()) {
-            qDebug() << "--- 致命错误: KataGo 目录未找到于:" << kataGoDir;
+    if (m_aiLevel == 2 && m_aiColor == 0) {
+        // 形势判断使用进程内共享的分析服务; 引擎在第一次请求时才启动
+        AnalysisService *service = AnalysisService::instance();
+        disconnect(service, nullptr, this, nullptr);
+        connect(service, &AnalysisService::resultReady, this, &SinglePlayerManager::onKataGoAnalysisResponse);
+        connect(service, &AnalysisService::queryFailed, this, &SinglePlayerManager::onKataGoAnalysisFailed);
+        m_analysisIds.clear();
+        if (!AnalysisService::isAvailable()) {
             m_running = false;
             return;
         }
+    } else if (m_aiLevel == 2) {
+        if (!m_engine) {
+            m_engine = new EngineConnection(this);
+            connect(m_engine, &EngineConnection::gtpResponse, this, &SinglePlayerManager::onKataGoGtpResponse);
+            connect(m_engine, &EngineConnection::processError, this, &SinglePlayerManager::onKataGoProcessError);
+        }
+        m_genmoveId = -1;
 
-        QString kataGoExePath = kataGoDir + "katago.exe";
-        QString modelPath = "model.bin";
-        QString configPath = "gtp_config.cfg";
-
-        if (!QFile::exists(kataGoExePath)) {
-            qDebug() << "--- 致命错误: katago.exe 未找到于:" << kataGoExePath;
+        QString kataGoExePath, kataGoDir;
+        if (!EngineConnection::locateKataGo(&kataGoExePath, &kataGoDir)) {
             m_running = false;
             return;
         }
 
-        m_kataGoProcess->setWorkingDirectory(kataGoDir);
-
+        qDebug() << "以 GTP 对弈模式启动 KataGo...";
         QStringList arguments;
-        if (m_aiColor == 0) { // 分析引擎
-            qDebug() << "以分析模式启动 KataGo...";
-            arguments << "analysis" << "-model" << modelPath << "-config" << configPath;
-        } else { // 对弈引擎
-            qDebug() << "以 GTP 对弈模式启动 KataGo...";
-            arguments << "gtp" << "-model" << modelPath << "-config" << configPath;
-        }
-
-        qDebug() << "工作目录:" << kataGoDir;
-        qDebug() << "可执行文件:" << kataGoExePath;
-        qDebug() << "参数:" << arguments.join(" ");
+        arguments << "gtp" << "-model" << "model.bin" << "-config" << "gtp_config.cfg";
 
-        m_kataGoProcess->start(kataGoExePath, arguments);
-
-        if (!m_kataGoProcess->waitForStarted(5000)) {
-            qDebug() << "--- KATA GO 启动失败 ---";
-            qDebug() << "错误码:" << m_kataGoProcess->error();
-            qDebug() << "错误信息:" << m_kataGoProcess->errorString();
-        } else {
-            qDebug() << "KataGo 进程启动成功。";
-            if (m_aiColor != 0) {
-                const QByteArray boardsizeCmd = QString("boardsize %1\n").arg(m_board->goban().size()).toUtf8();
-                m_kataGoProcess->write(boardsizeCmd);
-                m_kataGoProcess->write("clear_board\n");
-            }
-        }
+        // 异步启动, 以下命令在模型加载完成后才真正发出
+        m_engine->start(kataGoExePath, arguments, kataGoDir);
+        m_engine->sendGtp(QString("boardsize %1").arg(m_board->goban().size()).toUtf8());
+        m_engine->sendGtp("clear_board");
     }
 
     // 仅当作为对弈AI时, 才启动定时器检查
@@ -134,14 +102,17 @@ void SinglePlayerManager::stop()
     }
     m_board = nullptr;
 
-    if (m_kataGoProcess && m_kataGoProcess->state() == QProcess::Running) {
-        m_kataGoProcess->write("quit\n");
-        if (!m_kataGoProcess->waitForFinished(1000)) {
-            m_kataGoProcess->kill();
-        }
+    if (m_engine) {
+        m_engine->stop();
+        delete m_engine;
+        m_engine = nullptr;
     }
-    delete m_kataGoProcess;
-    m_kataGoProcess = nullptr;
+    m_genmoveId = -1;
+    // 共享分析服务由所有窗口共用, 不随本对象停止; 只终止本对象尚未完成的请求
+    for (auto it = m_analysisIds.constBegin(); it != m_analysisIds.constEnd(); ++it) {
+        AnalysisService::instance()->cancel(it.key());
+    }
+    m_analysisIds.clear();
 
     qDebug() << "[SinglePlayer] 已停止";
 }
@@ -149,7 +120,10 @@ void SinglePlayerManager::stop()
 void SinglePlayerManager::onBoardStateChanged()
 {
     if (!m_running || !m_board) return;
-    if (m_aiColor == 0) return; // 分析引擎模式下不响应棋盘变化
+    if (m_aiColor == 0) { // 分析引擎模式下只需丢弃过期的分析
+        cancelStaleAnalysis();
+        return;
+    }
     int cur = m_board->currentPlayer();
     if (cur != m_aiColor) return;
     if (!m_timer->isActive()) {
@@ -161,8 +135,10 @@ void SinglePlayerManager::onBoardStateChanged()
 void SinglePlayerManager::onTimerTimeout()
 {
     if (!m_running || !m_board || m_board->currentPlayer() != m_aiColor) return;
+    m_perfMoveStart = PerfMonitor::isEnabled() ? PerfMonitor::nowUs() : -1;
     if (m_aiLevel < 2) {
         QPair<int,int> mv = chooseMoveLvl0_1();
+        if (m_perfMoveStart >= 0) PerfMonitor::record(PerfMonitor::AiMove, m_perfMoveStart);
         emit moveReady(mv.first, mv.second);
     } else {
         requestKataGoMove();
@@ -171,132 +147,147 @@ void SinglePlayerManager::onTimerTimeout()
 
 void SinglePlayerManager::requestKataGoMove()
 {
-    if (!m_kataGoProcess || m_kataGoProcess->state() != QProcess::Running) {
+    if (!m_engine || !m_engine->isRunning()) {
         qDebug() << "KataGo (GTP 模式) 未运行!";
         emit moveReady(-1, -1);
         return;
     }
 
+    // 命令按编号流水发送, 无需等待前一条的响应; 只关心 genmove 的结果
     const Goban& g = m_board->goban();
-    m_kataGoProcess->write("clear_board\n");
+    m_engine->sendGtp("clear_board");
 
-    QByteArray playCommands;
     for(int i = 0; i < g.size(); ++i) {
         for(int j = 0; j < g.size(); ++j) {
             if (g.get(i, j) != 0) {
                 QString color = (g.get(i, j) == 1) ? "B" : "W";
-                char colChar = 'A' + j;
-                if (colChar >= 'I') colChar++;
-                int row = g.size() - i;
-                playCommands.append(QString("play %1 %2%3\n").arg(color).arg(colChar).arg(row).toUtf8());
+                m_engine->sendGtp(QString("play %1 %2").arg(color, EngineConnection::gtpVertex(i, j, g.size())).toUtf8());
             }
         }
     }
-    m_kataGoProcess->write(playCommands);
 
     QString player = (m_aiColor == 1) ? "B" : "W";
-    const QByteArray genmoveCommand = QString("genmove %1\n").arg(player).toUtf8();
-    qDebug() << "发送到 KataGo (GTP):" << QString::fromUtf8(genmoveCommand).trimmed();
-    m_kataGoProcess->write(genmoveCommand);
+    m_genmoveId = m_engine->sendGtp(QString("genmove %1").arg(player).toUtf8());
+    qDebug() << "发送到 KataGo (GTP): genmove" << player << "id=" << m_genmoveId;
 }
 
-// 这是回退到的 "Talking Nonsense" 版本函数
-void SinglePlayerManager::requestAnalysis()
+void SinglePlayerManager::requestAnalysis(AnalysisService::Priority priority)
 {
-    if (!m_kataGoProcess || m_kataGoProcess->state() != QProcess::Running) {
+    if (!m_running || !m_board || !AnalysisService::isAvailable()) {
         qDebug() << "分析引擎未运行!";
         return;
     }
 
     const Goban& g = m_board->goban();
 
-    // --- 核心修复：从真实的下棋历史构建 moves 数组 ---
+    // 从真实的下棋历史构建 moves 数组
     QJsonArray movesArray;
-    const auto& moveHistory = g.getMoveHistory(); // 获取准确的历史记录
+    const auto& moveHistory = g.getMoveHistory();
 
     for (const auto& moveRecord : moveHistory) {
         const auto& pos = moveRecord.first;
         int colorInt = moveRecord.second;
 
-        QString player = (colorInt == 1) ? "B" : "W";
-        char colChar = 'A' + pos.second; // pos.second 是 j 坐标
-        if (colChar >= 'I') colChar++;
-        int row = g.size() - pos.first; // pos.first 是 i 坐标
-        QString moveStr = QString(colChar) + QString::number(row);
-
         QJsonArray moveJson;
-        moveJson.append(player);
-        moveJson.append(moveStr);
+        moveJson.append((colorInt == 1) ? "B" : "W");
+        moveJson.append(EngineConnection::gtpVertex(pos.first, pos.second, g.size()));
         movesArray.append(moveJson);
     }
-    // --- 修复结束 ---
 
     QJsonObject request;
-    request["id"] = "qt_analysis_query";
-    request["moves"] = movesArray; // 现在这里包含了正确的、有顺序的历史
+    request["moves"] = movesArray;
     request["rules"] = "tromp-taylor";
     request["komi"] = 7.5;
     request["boardXSize"] = g.size();
     request["boardYSize"] = g.size();
-    request["maxVisits"] = 200;
+    request["maxVisits"] = m_maxVisits;
     request["includeOwnership"] = true;
+    // 搜索途中定期推送中间结果, 先给出粗略估计再逐步精确
+    if (m_reportIntervalMs > 0) request["reportDuringSearchEvery"] = m_reportIntervalMs / 1000.0;
+
+    // id 由共享分析服务分配, 多个请求可同时在途; 相同局面与参数的结果直接取缓存
+    quint64 cacheKey = AnalysisCache::makeKey(g.hash(), g.size(), 7.5, "tromp-taylor", m_maxVisits);
+    QString id = AnalysisService::instance()->submit(request, priority, cacheKey);
+    if (!id.isEmpty()) m_analysisIds.insert(id, positionKey());
+    qDebug() << "发送分析请求:" << id << " 手数:" << movesArray.size();
+}
+
+void SinglePlayerManager::onKataGoGtpResponse(int id, bool ok, const QString &payload)
+{
+    if (id != m_genmoveId) {
+        if (!ok) qDebug() << "KataGo GTP 命令" << id << "失败:" << payload;
+        return;
+    }
+    m_genmoveId = -1;
+    if (m_perfMoveStart >= 0) PerfMonitor::record(PerfMonitor::AiMove, m_perfMoveStart);
+    if (!ok || !m_board) {
+        qDebug() << "genmove 失败:" << payload;
+        emit moveReady(-1, -1);
+        return;
+    }
 
-    QJsonDocument doc(request);
-    QByteArray jsonQuery = doc.toJson(QJsonDocument::Compact);
-    qDebug() << "发送修正后的分析请求:" << QString::fromUtf8(jsonQuery);
-    m_kataGoProcess->write(jsonQuery + "\n");
+    QString moveStr = payload.section(' ', 0, 0).toUpper();
+    int i = -1, j = -1;
+    if (EngineConnection::parseGtpVertex(moveStr, m_board->goban().size(), &i, &j)) {
+        qDebug() << "成功解析落子:" << moveStr << "-> (" << i << "," << j << ")";
+        emit moveReady(i, j);
+    } else {
+        // PASS / RESIGN
+        emit moveReady(-1, -1);
+    }
 }
 
+void SinglePlayerManager::onKataGoProcessError(const QString &message)
+{
+    // 引擎意外退出时, 正在等待的 genmove 不会再有响应, 按虚着处理以免对局卡住
+    if (m_genmoveId < 0) return;
+    qDebug() << "KataGo (GTP 模式) 不可用:" << message;
+    m_genmoveId = -1;
+    emit moveReady(-1, -1);
+}
 
-void SinglePlayerManager::onKataGoReadyRead()
+void SinglePlayerManager::onKataGoAnalysisResponse(const QString &id, const QJsonObject &response)
 {
-    m_kataGoBuffer.append(m_kataGoProcess->readAllStandardOutput());
-    while (m_kataGoBuffer.contains('\n')) {
-        int newlinePos = m_kataGoBuffer.indexOf('\n');
-        QByteArray line = m_kataGoBuffer.left(newlinePos);
-        m_kataGoBuffer.remove(0, newlinePos + 1);
-
-        QJsonParseError error;
-        QJsonDocument doc = QJsonDocument::fromJson(line, &error);
-
-        if (error.error == QJsonParseError::NoError && doc.isObject()) {
-            QJsonObject obj = doc.object();
-            if(obj.value("id").toString() == "qt_analysis_query") {
-                if (obj.contains("ownership")) {
-                    qDebug() << "成功解析含所有权数据的分析JSON。";
-                    emit analysisReady(obj);
-                    return;
-                }
-            }
-        } else {
-            QString response = QString::fromLatin1(line).trimmed();
-            if (response.startsWith("=")) {
-                QString moveStr = response.section(' ', 1, 1).toUpper();
-                if (moveStr.isEmpty()) continue;
-                if (moveStr == "PASS" || moveStr == "RESIGN") {
-                    emit moveReady(-1, -1);
-                    return;
-                }
-                if (moveStr.length() >= 2) {
-                    int j = moveStr[0].toLatin1() - 'A';
-                    if (moveStr[0].toLatin1() > 'I') j--;
-                    bool ok;
-                    int row = moveStr.mid(1).toInt(&ok);
-                    if(ok){
-                        int i = m_board->goban().size() - row;
-                        qDebug() << "成功解析落子:" << moveStr << "-> (" << i << "," << j << ")";
-                        emit moveReady(i, j);
-                        return;
-                    }
-                }
-            }
-        }
+    if (!m_analysisIds.contains(id)) return;
+    if (response.value("isDuringSearch").toBool(false)) {
+        emit analysisUpdated(response);
+        return;
+    }
+    m_analysisIds.remove(id);
+    if (response.contains("ownership")) {
+        qDebug() << "成功解析含所有权数据的分析JSON。";
+        emit analysisReady(response);
+    } else {
+        emit analysisFailed(tr("分析结果缺少所有权数据"));
     }
 }
 
-void SinglePlayerManager::onKataGoError(QProcess::ProcessError error)
+void SinglePlayerManager::onKataGoAnalysisFailed(const QString &id, const QString &message)
+{
+    // 失败的请求不会再有结果, 从在途表中移除, 并通知界面不再等待
+    if (!m_analysisIds.remove(id)) return;
+    qDebug() << "分析请求" << id << "失败:" << message;
+    emit analysisFailed(message);
+}
+
+QString SinglePlayerManager::positionKey() const
 {
-    qDebug() << "KataGo 进程错误:" << error << m_kataGoProcess->errorString();
+    if (!m_board) return QString();
+    const Goban &g = m_board->goban();
+    return QString::fromStdString(g.serialize()) + QString::number(g.currentPlayer());
+}
+
+void SinglePlayerManager::cancelStaleAnalysis()
+{
+    const QString key = positionKey();
+    for (auto it = m_analysisIds.begin(); it != m_analysisIds.end();) {
+        if (it.value() != key) {
+            AnalysisService::instance()->cancel(it.key());
+            it = m_analysisIds.erase(it);
+        } else {
+            ++it;
+        }
+    }
 }
 
 QPair<int,int> SinglePlayerManager::chooseMoveLvl0_1()
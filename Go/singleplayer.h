@@ -3,11 +3,12 @@
 
 #include <QObject>
 #include <QPair>
-#include <QProcess>
-#include <QByteArray>
+#include <QHash>
 #include <QJsonObject>
+#include "analysisservice.h"
 
 class BoardWidget;
+class EngineConnection;
 class QTimer;
 
 /*
@@ -30,29 +31,42 @@ public:
     // 停止单机模式
     void stop();
     bool isRunning() const { return m_running; }
-    // 请求形势判断
-    void requestAnalysis();
+    // 请求形势判断 (仅分析模式, 即 aiColor=0 时有效)
+    void requestAnalysis(AnalysisService::Priority priority = AnalysisService::Interactive);
+    // 分析的访问数上限与中间结果的推送间隔 (毫秒, 0 表示只要最终结果)
+    void setAnalysisVisits(int maxVisits) { m_maxVisits = qMax(1, maxVisits); }
+    void setAnalysisReportInterval(int ms) { m_reportIntervalMs = qMax(0, ms); }
 
 signals:
     // AI 计算出下一步后发出此信号 (坐标为 (-1,-1) 表示虚着)
     void moveReady(int i, int j);
+    // 搜索途中的中间分析结果 (随访问数增加逐步精确)
+    void analysisUpdated(const QJsonObject& analysisData);
     // 形势判断数据准备就绪
     void analysisReady(const QJsonObject& analysisData);
+    // 形势判断请求失败 (引擎出错或结果不含所有权数据)
+    void analysisFailed(const QString &message);
 
 private slots:
     void onBoardStateChanged();
     void onTimerTimeout();
 
-    // KataGo 进程有输出时触发
-    void onKataGoReadyRead();
-    // KataGo 进程出错时触发
-    void onKataGoError(QProcess::ProcessError error);
+    // KataGo GTP 响应 (按命令编号匹配)
+    void onKataGoGtpResponse(int id, bool ok, const QString &payload);
+    void onKataGoProcessError(const QString &message);
+    // 共享分析服务的响应 (按请求 id 过滤出属于本对象的)
+    void onKataGoAnalysisResponse(const QString &id, const QJsonObject &response);
+    void onKataGoAnalysisFailed(const QString &id, const QString &message);
 
 private:
     // 等级0和1的AI走棋逻辑
     QPair<int,int> chooseMoveLvl0_1();
     // 向 KataGo 引擎请求下一步走棋
     void requestKataGoMove();
+    // 当前局面的标识, 用于判断分析结果是否已过期
+    QString positionKey() const;
+    // 终止所有与当前局面不符的在途分析
+    void cancelStaleAnalysis();
 
     BoardWidget *m_board;
     int m_aiColor;
@@ -60,8 +74,14 @@ private:
     bool m_running;
     QTimer *m_timer;
 
-    QProcess *m_kataGoProcess = nullptr;
-    QByteArray m_kataGoBuffer;
+    EngineConnection *m_engine = nullptr;
+    // 当前等待的 genmove 命令编号
+    int m_genmoveId = -1;
+    qint64 m_perfMoveStart = -1; // 性能埋点: 本次 AI 思考开始时间 (微秒)
+    // 在途的分析请求 id -> 发出请求时的局面标识
+    QHash<QString, QString> m_analysisIds;
+    int m_maxVisits = 200;
+    int m_reportIntervalMs = 200;
 };
 
 #endif // SINGLEPLAYER_H
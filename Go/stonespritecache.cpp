@@ -0,0 +1,47 @@
+#include "stonespritecache.h"
+
+#include <QPainter>
+#include <QtMath>
+
+QHash<quint64, QPixmap> &StoneSpriteCache::cache()
+{
+    static QHash<quint64, QPixmap> s_cache;
+    return s_cache;
+}
+
+const QPixmap &StoneSpriteCache::sprite(int color, int radius, qreal dpr)
+{
+    radius = qMax(1, radius);
+    quint64 key = (quint64(color) << 48) | (quint64(radius) << 24) | quint64(qRound(dpr * 100));
+    QHash<quint64, QPixmap> &c = cache();
+    auto it = c.find(key);
+    if (it == c.end()) it = c.insert(key, render(color, radius, dpr));
+    return it.value();
+}
+
+void StoneSpriteCache::clear()
+{
+    cache().clear();
+}
+
+QPixmap StoneSpriteCache::render(int color, int radius, qreal dpr)
+{
+    // 多留 1 像素给描边
+    const int side = 2 * radius + 2;
+    QPixmap pm(qCeil(side * dpr), qCeil(side * dpr));
+    pm.setDevicePixelRatio(dpr);
+    pm.fill(Qt::transparent);
+
+    QPainter p(&pm);
+    p.setRenderHint(QPainter::Antialiasing, true);
+    const QPointF center(radius + 1, radius + 1);
+    if (color == 1) {
+        p.setPen(Qt::black);
+        p.setBrush(Qt::black);
+    } else {
+        p.setPen(Qt::gray);
+        p.setBrush(Qt::white);
+    }
+    p.drawEllipse(center, radius, radius);
+    return pm;
+}
@@ -0,0 +1,27 @@
+#ifndef STONESPRITECACHE_H
+#define STONESPRITECACHE_H
+
+#include <QPixmap>
+#include <QHash>
+
+/*
+ StoneSpriteCache: 预渲染的棋子贴图
+  - 按 (颜色, 直径, 设备像素比) 缓存, 同一尺寸的所有棋盘共用一份
+  - 抗锯齿只在生成贴图时做一次, 绘制棋子只是一次 drawPixmap
+  - 仅在界面线程使用
+*/
+class StoneSpriteCache
+{
+public:
+    // color: 1=黑, 2=白; radius 为逻辑像素的棋子半径
+    static const QPixmap &sprite(int color, int radius, qreal dpr);
+    // 贴图左上角相对交叉点中心的偏移
+    static QPoint offset(int radius) { return QPoint(-radius - 1, -radius - 1); }
+    static void clear();
+
+private:
+    static QPixmap render(int color, int radius, qreal dpr);
+    static QHash<quint64, QPixmap> &cache();
+};
+
+#endif // STONESPRITECACHE_H
@@ -0,0 +1,189 @@
+#include "wirecodec.h"
+
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QCborValue>
+#include <QCborArray>
+#include <QCborMap>
+#include <initializer_list>
+
+namespace {
+// 紧凑数组的首元素
+enum CompactTag {
+    TagMove = 1,  // [1, x, y (, room_id)]
+    TagPass = 2,  // [2 (, room_id)]
+    TagTurn = 3,  // [3, currentPlayer (, room_id)]
+    TagDelta = 4, // [4, seq, x, y, next, hash, [i, j, ...] (, room_id)]
+    TagSync = 5   // [5, seq, currentPlayer, 压缩盘面字节 (, room_id)]
+};
+
+bool isInt(const QJsonValue &v)
+{
+    return v.isDouble() && double(v.toInt()) == v.toDouble();
+}
+
+// obj 除 type 与可选的 room_id 外恰好包含 fields 中的整数字段时, 才能无损地编码为紧凑数组
+bool fitsCompact(const QJsonObject &obj, std::initializer_list<const char *> fields, int extraFields = 0)
+{
+    int expected = 1 + int(fields.size()) + extraFields + (obj.contains("room_id") ? 1 : 0);
+    if (obj.size() != expected) return false;
+    if (obj.contains("room_id") && !obj.value("room_id").isString()) return false;
+    for (const char *f : fields) {
+        if (!isInt(obj.value(QLatin1String(f)))) return false;
+    }
+    return true;
+}
+
+// 局面哈希在 JSON 中为十六进制字符串, 紧凑格式中为 64 位整数; 仅规范写法可无损转换
+bool hashToInt(const QJsonValue &v, qint64 *out)
+{
+    bool ok = false;
+    const QString s = v.toString();
+    quint64 h = s.toULongLong(&ok, 16);
+    if (!ok || QString::number(h, 16) != s) return false;
+    *out = qint64(h);
+    return true;
+}
+
+bool intArray(const QJsonValue &v, QCborArray *out)
+{
+    if (!v.isArray()) return false;
+    const QJsonArray arr = v.toArray();
+    for (const auto &e : arr) {
+        if (!isInt(e)) return false;
+        out->append(e.toInt());
+    }
+    return true;
+}
+
+bool encodeCompact(const QJsonObject &obj, QCborArray *out)
+{
+    const QString type = obj.value("type").toString();
+    if (type == "move" && fitsCompact(obj, {"x", "y"})) {
+        *out = {int(TagMove), obj.value("x").toInt(), obj.value("y").toInt()};
+    } else if (type == "pass" && fitsCompact(obj, {})) {
+        *out = {int(TagPass)};
+    } else if (type == "turn" && fitsCompact(obj, {"currentPlayer"})) {
+        *out = {int(TagTurn), obj.value("currentPlayer").toInt()};
+    } else if (type == "delta" && fitsCompact(obj, {"seq", "x", "y", "next"}, 2)) {
+        qint64 hash = 0;
+        QCborArray captures;
+        if (!hashToInt(obj.value("hash"), &hash) || !intArray(obj.value("captures"), &captures)) return false;
+        *out = {int(TagDelta), obj.value("seq").toInt(), obj.value("x").toInt(), obj.value("y").toInt(),
+                obj.value("next").toInt(), hash, captures};
+    } else if (type == "sync" && fitsCompact(obj, {"seq", "currentPlayer"}, 1) && obj.value("packed").isString()) {
+        const QByteArray b64 = obj.value("packed").toString().toLatin1();
+        const QByteArray packed = QByteArray::fromBase64(b64);
+        if (packed.toBase64() != b64) return false;
+        *out = {int(TagSync), obj.value("seq").toInt(), obj.value("currentPlayer").toInt(), packed};
+    } else {
+        return false;
+    }
+    if (obj.contains("room_id")) out->append(obj.value("room_id").toString());
+    return true;
+}
+
+bool decodeCompact(const QCborArray &arr, QJsonObject *out)
+{
+    if (arr.isEmpty() || !arr.at(0).isInteger()) return false;
+    QJsonObject obj;
+    int roomIndex = -1;
+    switch (arr.at(0).toInteger()) {
+    case TagMove:
+        if (arr.size() < 3) return false;
+        obj["type"] = "move";
+        obj["x"] = int(arr.at(1).toInteger());
+        obj["y"] = int(arr.at(2).toInteger());
+        roomIndex = 3;
+        break;
+    case TagPass:
+        obj["type"] = "pass";
+        roomIndex = 1;
+        break;
+    case TagTurn:
+        if (arr.size() < 2) return false;
+        obj["type"] = "turn";
+        obj["currentPlayer"] = int(arr.at(1).toInteger());
+        roomIndex = 2;
+        break;
+    case TagDelta: {
+        if (arr.size() < 7 || !arr.at(6).isArray()) return false;
+        obj["type"] = "delta";
+        obj["seq"] = int(arr.at(1).toInteger());
+        obj["x"] = int(arr.at(2).toInteger());
+        obj["y"] = int(arr.at(3).toInteger());
+        obj["next"] = int(arr.at(4).toInteger());
+        obj["hash"] = QString::number(quint64(arr.at(5).toInteger()), 16);
+        QJsonArray captures;
+        const QCborArray caps = arr.at(6).toArray();
+        for (const auto &c : caps) captures.append(int(c.toInteger()));
+        obj["captures"] = captures;
+        roomIndex = 7;
+        break;
+    }
+    case TagSync:
+        if (arr.size() < 4 || !arr.at(3).isByteArray()) return false;
+        obj["type"] = "sync";
+        obj["seq"] = int(arr.at(1).toInteger());
+        obj["currentPlayer"] = int(arr.at(2).toInteger());
+        obj["packed"] = QString::fromLatin1(arr.at(3).toByteArray().toBase64());
+        roomIndex = 4;
+        break;
+    default:
+        return false;
+    }
+    if (arr.size() > roomIndex && arr.at(roomIndex).isString()) obj["room_id"] = arr.at(roomIndex).toString();
+    *out = obj;
+    return true;
+}
+}
+
+QByteArray WireCodec::encode(const QJsonObject &obj, Format format)
+{
+    if (format == Json) return QJsonDocument(obj).toJson(QJsonDocument::Compact);
+
+    QCborArray compact;
+    if (encodeCompact(obj, &compact)) return QCborValue(compact).toCbor();
+    return QCborValue(QCborMap::fromJsonObject(obj)).toCbor();
+}
+
+bool WireCodec::decode(const QByteArray &data, bool binary, QJsonObject *out)
+{
+    if (!binary) {
+        QJsonParseError err;
+        QJsonDocument doc = QJsonDocument::fromJson(data, &err);
+        if (err.error != QJsonParseError::NoError || !doc.isObject()) return false;
+        *out = doc.object();
+        return true;
+    }
+
+    QCborParserError err;
+    QCborValue v = QCborValue::fromCbor(data, &err);
+    if (err.error != QCborError::NoError) return false;
+    if (v.isArray()) return decodeCompact(v.toArray(), out);
+    if (!v.isMap()) return false;
+    *out = v.toMap().toJsonObject();
+    return true;
+}
+
+QString WireCodec::formatName(Format format)
+{
+    return format == Cbor ? QStringLiteral("cbor") : QStringLiteral("json");
+}
+
+QStringList WireCodec::supportedNames()
+{
+    return {QStringLiteral("cbor"), QStringLiteral("json")};
+}
+
+WireCodec::Format WireCodec::negotiate(const QStringList &offered)
+{
+    return offered.contains(QStringLiteral("cbor")) ? Cbor : Json;
+}
+
+bool WireCodec::isControl(const QString &type)
+{
+    return type == QLatin1String("hello") || type == QLatin1String("hello_ack") ||
+           type == QLatin1String("resume") || type == QLatin1String("resume_result") ||
+           type == QLatin1String("ack") || type == QLatin1String("ping") || type == QLatin1String("pong");
+}
@@ -0,0 +1,39 @@
+#ifndef WIRECODEC_H
+#define WIRECODEC_H
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <QStringList>
+
+/*
+ WireCodec: 客户端与服务端共用的消息编解码
+  - Json: 紧凑 JSON 文本, 通过 sendTextMessage 发送 (未协商或协商失败时使用)
+  - Cbor: 二进制, 通过 sendBinaryMessage 发送
+    * 高频消息 (落子/虚着/轮次/增量) 与全量盘面编码为 CBOR 数组 [标签, 参数...], 一手棋只有十几个字节,
+      压缩盘面以原始字节传输 (JSON 中为 base64)
+    * 其余消息为与 JSON 等价的 CBOR map
+  - 协商: 客户端连接后以 JSON 发送 {"type":"hello","codecs":["cbor","json"]},
+    服务端以 JSON 回复 {"type":"hello_ack","codec":"cbor"} 后, 双方改用二进制发送;
+    旧版本不认识 hello 时保持 JSON. 接收方始终同时接受文本与二进制消息
+  - 控制消息 (hello/hello_ack/resume/resume_result/ack/ping/pong) 属于单条连接, 不计入会话消息序号,
+    也不进入断线补发队列
+*/
+class WireCodec
+{
+public:
+    enum Format { Json, Cbor };
+
+    static QByteArray encode(const QJsonObject &obj, Format format);
+    // binary 表示收到的是二进制帧; 解析失败返回 false
+    static bool decode(const QByteArray &data, bool binary, QJsonObject *out);
+
+    static QString formatName(Format format);
+    // 本端支持的编码, 按优先级排列
+    static QStringList supportedNames();
+    // 从对方提供的编码列表中选出双方都支持的最优编码
+    static Format negotiate(const QStringList &offered);
+    // 是否为连接级控制消息 (见上)
+    static bool isControl(const QString &type);
+};
+
+#endif // WIRECODEC_H
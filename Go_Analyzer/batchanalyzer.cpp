@@ -0,0 +1,255 @@
+#include "batchanalyzer.h"
+#include "engineconnection.h"
+
+#include <QTextStream>
+#include <QTimer>
+#include <QJsonArray>
+#include <QFileInfo>
+#include <QDebug>
+
+namespace {
+// SGF 的 RU 属性转为 KataGo 的规则名; 无法识别时与客户端一致使用 tromp-taylor
+QString kataGoRules(const QString &sgfRules)
+{
+    QString r = sgfRules.toLower();
+    if (r.contains("japan")) return "japanese";
+    if (r.contains("chinese")) return "chinese";
+    if (r.contains("korea")) return "korean";
+    if (r.contains("aga")) return "aga";
+    if (r.contains("new zealand") || r == "nz") return "new-zealand";
+    return "tromp-taylor";
+}
+
+QString colorName(int color)
+{
+    return color == 1 ? "B" : "W";
+}
+}
+
+BatchAnalyzer::BatchAnalyzer(QTextStream *out, QObject *parent)
+    : QObject(parent),
+      m_out(out),
+      m_reportTimer(new QTimer(this))
+{
+    m_reportTimer->setInterval(5000);
+    connect(m_reportTimer, &QTimer::timeout, this, &BatchAnalyzer::reportProgress);
+}
+
+BatchAnalyzer::~BatchAnalyzer()
+{
+    for (EngineConnection *engine : qAsConst(m_engines)) engine->stop();
+}
+
+void BatchAnalyzer::setEngine(const QString &program, const QStringList &arguments, const QString &workingDir)
+{
+    m_program = program;
+    m_arguments = arguments;
+    m_workingDir = workingDir;
+}
+
+void BatchAnalyzer::addFiles(const QStringList &files)
+{
+    for (const QString &f : files) m_files.enqueue(f);
+}
+
+bool BatchAnalyzer::start()
+{
+    if (m_files.isEmpty()) {
+        qWarning() << "没有需要分析的棋谱";
+        return false;
+    }
+
+    for (int k = 0; k < m_processCount; ++k) {
+        EngineConnection *engine = new EngineConnection(this);
+        connect(engine, &EngineConnection::ready, this, &BatchAnalyzer::onEngineReady);
+        connect(engine, &EngineConnection::analysisResponse, this, &BatchAnalyzer::onAnalysisResponse);
+        connect(engine, &EngineConnection::analysisError, this, &BatchAnalyzer::onAnalysisError);
+        connect(engine, &EngineConnection::processError, this, &BatchAnalyzer::onProcessError);
+        if (!engine->start(m_program, m_arguments, m_workingDir)) {
+            delete engine;
+            continue;
+        }
+        m_engines.append(engine);
+        m_inFlight.append(0);
+    }
+    if (m_engines.isEmpty()) {
+        qWarning() << "无法启动分析引擎:" << m_program;
+        return false;
+    }
+
+    *m_out << "#file\tturn\tmove\twinrate\tscoreLead\tbest\tvisits\n";
+    m_clock.start();
+    m_reportTimer->start();
+    qInfo().noquote() << QString("引擎进程: %1, 每进程在途请求上限: %2, 棋谱: %3")
+                         .arg(m_engines.size()).arg(m_maxInFlight).arg(m_files.size());
+    return true;
+}
+
+void BatchAnalyzer::onEngineReady()
+{
+    pump();
+}
+
+bool BatchAnalyzer::nextQuery(QJsonObject *query, Job *job)
+{
+    while (!m_files.isEmpty()) {
+        QString file = m_files.dequeue();
+        SgfGame game;
+        QString err;
+        if (!SgfReader::parseFile(file, &game, &err)) {
+            qWarning().noquote() << "跳过" << file << ":" << err;
+            ++m_gamesFailed;
+            continue;
+        }
+
+        // 与 SinglePlayerManager::requestAnalysis 相同的坐标换算
+        QJsonArray movesArray;
+        job->file = file;
+        job->moves.clear();
+        job->moves.reserve(game.moves.size());
+        for (const SgfMove &m : game.moves) {
+            QString vertex = m.isPass() ? QStringLiteral("pass") : EngineConnection::gtpVertex(m.i, m.j, game.boardSize);
+            job->moves.append(vertex);
+            movesArray.append(QJsonArray{ colorName(m.color), vertex });
+        }
+        QJsonArray initialStones;
+        for (const SgfMove &m : game.setup) {
+            initialStones.append(QJsonArray{ colorName(m.color), EngineConnection::gtpVertex(m.i, m.j, game.boardSize) });
+        }
+        QJsonArray analyzeTurns;
+        for (int t = 0; t <= game.moves.size(); ++t) analyzeTurns.append(t);
+
+        QJsonObject q;
+        q["id"] = QStringLiteral("g%1").arg(m_nextId++);
+        q["moves"] = movesArray;
+        if (!initialStones.isEmpty()) q["initialStones"] = initialStones;
+        if (game.initialPlayer) q["initialPlayer"] = colorName(game.initialPlayer);
+        q["rules"] = kataGoRules(game.rules);
+        q["komi"] = game.komi;
+        q["boardXSize"] = game.boardSize;
+        q["boardYSize"] = game.boardSize;
+        q["maxVisits"] = m_maxVisits;
+        q["analyzeTurns"] = analyzeTurns;
+        job->remaining = analyzeTurns.size();
+        *query = q;
+        return true;
+    }
+    return false;
+}
+
+void BatchAnalyzer::pump()
+{
+    for (int k = 0; k < m_engines.size(); ++k) {
+        EngineConnection *engine = m_engines[k];
+        if (!engine->isReady() || !engine->isRunning()) continue;
+        while (m_inFlight[k] < m_maxInFlight) {
+            QJsonObject query;
+            Job job;
+            if (!nextQuery(&query, &job)) {
+                checkDone();
+                return;
+            }
+            job.engine = k;
+            QString id = engine->sendAnalysis(query);
+            m_jobs.insert(id, job);
+            ++m_inFlight[k];
+        }
+    }
+}
+
+void BatchAnalyzer::onAnalysisResponse(const QString &id, const QJsonObject &response)
+{
+    auto it = m_jobs.find(id);
+    if (it == m_jobs.end() || response.value("isDuringSearch").toBool(false)) return;
+    Job &job = it.value();
+
+    int turn = response.value("turnNumber").toInt();
+    QJsonObject rootInfo = response.value("rootInfo").toObject();
+    QString best;
+    const QJsonArray moveInfos = response.value("moveInfos").toArray();
+    for (const auto &mv : moveInfos) {
+        QJsonObject info = mv.toObject();
+        if (info.value("order").toInt(-1) == 0) {
+            best = info.value("move").toString();
+            break;
+        }
+    }
+
+    *m_out << job.file << '\t' << turn << '\t'
+           << (turn > 0 && turn <= job.moves.size() ? job.moves[turn - 1] : QStringLiteral("-")) << '\t'
+           << QString::number(rootInfo.value("winrate").toDouble(), 'f', 4) << '\t'
+           << QString::number(rootInfo.value("scoreLead").toDouble(), 'f', 2) << '\t'
+           << (best.isEmpty() ? QStringLiteral("-") : best) << '\t'
+           << rootInfo.value("visits").toInt() << '\n';
+    ++m_positions;
+
+    if (--job.remaining <= 0) {
+        ++m_gamesDone;
+        finishJob(id);
+    }
+}
+
+void BatchAnalyzer::onAnalysisError(const QString &id, const QString &message)
+{
+    auto it = m_jobs.constFind(id);
+    if (it == m_jobs.constEnd()) return;
+    qWarning().noquote() << "分析失败" << it.value().file << ":" << message;
+    ++m_gamesFailed;
+    finishJob(id);
+}
+
+void BatchAnalyzer::onProcessError(const QString &message)
+{
+    EngineConnection *engine = qobject_cast<EngineConnection *>(sender());
+    int k = m_engines.indexOf(engine);
+    qWarning().noquote() << "引擎进程" << k << "出错:" << message;
+
+    // 该进程上的在途棋谱记为失败
+    const QList<QString> ids = m_jobs.keys();
+    for (const QString &id : ids) {
+        if (m_jobs.value(id).engine == k) {
+            ++m_gamesFailed;
+            finishJob(id);
+        }
+    }
+
+    bool anyRunning = false;
+    for (EngineConnection *e : qAsConst(m_engines)) anyRunning = anyRunning || e->isRunning();
+    if (!anyRunning) {
+        m_gamesFailed += m_files.size();
+        m_files.clear();
+        checkDone();
+    }
+}
+
+void BatchAnalyzer::finishJob(const QString &id)
+{
+    Job job = m_jobs.take(id);
+    if (job.engine >= 0 && job.engine < m_inFlight.size()) --m_inFlight[job.engine];
+    m_out->flush();
+    pump();
+    checkDone();
+}
+
+void BatchAnalyzer::checkDone()
+{
+    if (m_finished || !m_files.isEmpty() || !m_jobs.isEmpty()) return;
+    m_finished = true;
+    m_reportTimer->stop();
+    m_out->flush();
+    reportProgress();
+    // 各引擎的 排队/首字节/完成 延迟分布, 用于区分管道通信与搜索耗时
+    for (int k = 0; k < m_engines.size(); ++k) {
+        QString report = m_engines[k]->latencyReport();
+        if (!report.isEmpty()) qInfo().noquote() << QString("引擎 %1 延迟统计:\n%2").arg(k).arg(report);
+    }
+    emit finished(m_gamesFailed > 0 ? 1 : 0);
+}
+
+void BatchAnalyzer::reportProgress()
+{
+    double secs = qMax<qint64>(1, m_clock.elapsed()) / 1000.0;
+    qInfo().noquote() << QString("已完成 %1 盘 (失败 %2, 剩余 %3), %4 个局面, %5 局面/秒")
+                         .arg(m_gamesDone).arg(m_gamesFailed).arg(m_files.size() + m_jobs.size())
+                         .arg(m_positions).arg(QString::number(m_positions / secs, 'f', 1));
+}
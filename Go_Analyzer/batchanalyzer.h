@@ -0,0 +1,87 @@
+#ifndef BATCHANALYZER_H
+#define BATCHANALYZER_H
+
+#include <QObject>
+#include <QStringList>
+#include <QQueue>
+#include <QHash>
+#include <QVector>
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include "sgfreader.h"
+
+class EngineConnection;
+class QTextStream;
+class QTimer;
+
+/*
+ BatchAnalyzer: 离线批量分析 SGF 棋谱
+  - 每盘棋一条分析请求 (analyzeTurns 覆盖所有手数), 坐标换算与客户端的形势判断一致
+  - 每个引擎进程同时在途的请求数有上限, 有名额空出时立即派发下一盘, 保持引擎满载
+  - 棋谱在派发时才读取解析, 数千盘的目录也不会一次性占用内存
+  - 每个局面输出一行制表符分隔的结果, 定期在 stderr 报告局面/秒
+*/
+class BatchAnalyzer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit BatchAnalyzer(QTextStream *out, QObject *parent = nullptr);
+    ~BatchAnalyzer();
+
+    void setEngine(const QString &program, const QStringList &arguments, const QString &workingDir);
+    void setProcessCount(int count) { m_processCount = qMax(1, count); }
+    void setMaxInFlightPerProcess(int count) { m_maxInFlight = qMax(1, count); }
+    void setMaxVisits(int visits) { m_maxVisits = qMax(1, visits); }
+    void addFiles(const QStringList &files);
+
+    // 启动引擎并开始分析; 全部完成后发出 finished()
+    bool start();
+
+signals:
+    void finished(int exitCode);
+
+private slots:
+    void onEngineReady();
+    void onAnalysisResponse(const QString &id, const QJsonObject &response);
+    void onAnalysisError(const QString &id, const QString &message);
+    void onProcessError(const QString &message);
+    void reportProgress();
+
+private:
+    // 一盘棋对应的在途请求
+    struct Job {
+        QString file;
+        int engine = -1;
+        int remaining = 0;      // 尚未返回的局面数
+        QVector<QString> moves; // 每一手的 GTP 坐标, 用于输出
+    };
+
+    void pump();
+    // 读取下一盘可分析的棋谱并构建请求; 没有更多棋谱时返回 false
+    bool nextQuery(QJsonObject *query, Job *job);
+    void finishJob(const QString &id);
+    void checkDone();
+
+    QTextStream *m_out;
+    QString m_program;
+    QStringList m_arguments;
+    QString m_workingDir;
+    int m_processCount = 1;
+    int m_maxInFlight = 4;
+    int m_maxVisits = 100;
+
+    QVector<EngineConnection *> m_engines;
+    QVector<int> m_inFlight; // 每个引擎的在途请求数
+    QQueue<QString> m_files;
+    QHash<QString, Job> m_jobs;
+    int m_nextId = 1;
+
+    QElapsedTimer m_clock;
+    QTimer *m_reportTimer;
+    qint64 m_positions = 0;
+    int m_gamesDone = 0;
+    int m_gamesFailed = 0;
+    bool m_finished = false;
+};
+
+#endif // BATCHANALYZER_H
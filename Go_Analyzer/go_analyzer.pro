@@ -0,0 +1,22 @@
+QT += core
+QT -= gui
+CONFIG += c++11 console
+CONFIG -= app_bundle
+TARGET = go_analyzer
+TEMPLATE = app
+
+# 与客户端共用引擎通信代码
+INCLUDEPATH += ../Go
+
+SOURCES += main.cpp \
+           batchanalyzer.cpp \
+           sgfreader.cpp \
+           ../Go/engineconnection.cpp \
+           ../Go/latencyhistogram.cpp \
+           ../Go/lineringbuffer.cpp
+
+HEADERS += batchanalyzer.h \
+           sgfreader.h \
+           ../Go/engineconnection.h \
+           ../Go/latencyhistogram.h \
+           ../Go/lineringbuffer.h
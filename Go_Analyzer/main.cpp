@@ -0,0 +1,80 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QFile>
+#include <QTextStream>
+#include <QDebug>
+#include "batchanalyzer.h"
+#include "engineconnection.h"
+
+// 离线批量分析: go_analyzer [选项] <棋谱文件或目录>...
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("go_analyzer");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("使用 KataGo 分析引擎批量分析 SGF 棋谱");
+    parser.addHelpOption();
+    parser.addPositionalArgument("paths", "SGF 文件或包含 SGF 文件的目录 (递归查找)", "<paths...>");
+    QCommandLineOption engineOpt("engine", "引擎可执行文件 (默认为程序目录下的 katago/katago.exe)", "exe");
+    QCommandLineOption engineArgsOpt("engine-args", "引擎启动参数",
+                                     "args", "analysis -model model.bin -config gtp_config.cfg");
+    QCommandLineOption processesOpt("processes", "引擎进程数", "n", "1");
+    QCommandLineOption inFlightOpt("in-flight", "每个引擎进程同时在途的棋谱数", "n", "4");
+    QCommandLineOption visitsOpt("visits", "每个局面的访问数上限", "n", "100");
+    QCommandLineOption outputOpt(QStringList() << "o" << "output", "结果输出文件 (默认为标准输出)", "file");
+    parser.addOptions({ engineOpt, engineArgsOpt, processesOpt, inFlightOpt, visitsOpt, outputOpt });
+    parser.process(a);
+
+    // 收集棋谱; 目录按路径排序, 保证多次运行的顺序一致
+    QStringList files;
+    for (const QString &path : parser.positionalArguments()) {
+        QFileInfo info(path);
+        if (info.isDir()) {
+            QStringList found;
+            QDirIterator it(path, QStringList() << "*.sgf" << "*.SGF", QDir::Files, QDirIterator::Subdirectories);
+            while (it.hasNext()) found << it.next();
+            found.sort();
+            files << found;
+        } else if (info.exists()) {
+            files << path;
+        } else {
+            qWarning().noquote() << "文件不存在:" << path;
+        }
+    }
+    if (files.isEmpty()) parser.showHelp(1);
+
+    // 引擎: 指定的可执行文件 (可以是本地的替身引擎) 或默认的 KataGo
+    QString exe = parser.value(engineOpt);
+    QString workDir;
+    if (exe.isEmpty()) {
+        if (!EngineConnection::locateKataGo(&exe, &workDir)) return 1;
+    } else {
+        workDir = QFileInfo(exe).absolutePath();
+    }
+
+    QFile outFile;
+    if (parser.isSet(outputOpt)) {
+        outFile.setFileName(parser.value(outputOpt));
+        if (!outFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
+            qWarning().noquote() << "无法写入" << outFile.fileName() << ":" << outFile.errorString();
+            return 1;
+        }
+    } else {
+        outFile.open(stdout, QIODevice::WriteOnly | QIODevice::Text);
+    }
+    QTextStream out(&outFile);
+
+    BatchAnalyzer analyzer(&out);
+    analyzer.setEngine(exe, QProcess::splitCommand(parser.value(engineArgsOpt)), workDir);
+    analyzer.setProcessCount(parser.value(processesOpt).toInt());
+    analyzer.setMaxInFlightPerProcess(parser.value(inFlightOpt).toInt());
+    analyzer.setMaxVisits(parser.value(visitsOpt).toInt());
+    analyzer.addFiles(files);
+    QObject::connect(&analyzer, &BatchAnalyzer::finished, &a, &QCoreApplication::exit);
+    if (!analyzer.start()) return 1;
+
+    return a.exec();
+}
@@ -0,0 +1,140 @@
+#include "sgfreader.h"
+
+#include <QFile>
+
+namespace {
+struct RawMove {
+    int color;
+    QByteArray value;
+};
+}
+
+bool SgfReader::parseFile(const QString &path, SgfGame *game, QString *err)
+{
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly)) {
+        if (err) *err = f.errorString();
+        return false;
+    }
+    return parse(f.readAll(), game, err);
+}
+
+bool SgfReader::parsePoint(const QByteArray &value, int boardSize, int *i, int *j)
+{
+    if (value.isEmpty() || (boardSize <= 19 && value == "tt")) {
+        *i = -1;
+        *j = -1;
+        return true;
+    }
+    if (value.size() != 2) return false;
+    // SGF 先列后行, 均从左上角的 'a' 开始
+    int col = value[0] - 'a';
+    int row = value[1] - 'a';
+    if (col < 0 || row < 0 || col >= boardSize || row >= boardSize) return false;
+    *i = row;
+    *j = col;
+    return true;
+}
+
+bool SgfReader::parse(const QByteArray &data, SgfGame *game, QString *err)
+{
+    auto fail = [err](const QString &msg) {
+        if (err) *err = msg;
+        return false;
+    };
+
+    *game = SgfGame();
+    QVector<RawMove> setup;
+    QVector<RawMove> moves;
+
+    const int n = data.size();
+    int pos = data.indexOf('(');
+    if (pos < 0) return fail(QStringLiteral("不是有效的 SGF 文件"));
+    ++pos;
+
+    QByteArray ident;
+    while (pos < n) {
+        char c = data[pos];
+        if (c == ')') {
+            // 主分支沿每层的第一个变化前进, 遇到的第一个 ')' 即主分支结束
+            break;
+        }
+        if (c == '[') {
+            // 读取一个属性值 (处理 '\' 转义)
+            QByteArray value;
+            ++pos;
+            while (pos < n && data[pos] != ']') {
+                if (data[pos] == '\\' && pos + 1 < n) ++pos;
+                value.append(data[pos]);
+                ++pos;
+            }
+            if (pos >= n) return fail(QStringLiteral("属性值未闭合"));
+            ++pos;
+
+            if (ident == "B" || ident == "W") {
+                moves.append({ ident == "B" ? 1 : 2, value });
+            } else if (ident == "AB" || ident == "AW") {
+                int color = ident == "AB" ? 1 : 2;
+                int colon = value.indexOf(':');
+                if (colon == 2 && value.size() == 5) {
+                    // 压缩的矩形点列表 "aa:cc"
+                    for (char x = value[0]; x <= value[3]; ++x) {
+                        for (char y = value[1]; y <= value[4]; ++y) {
+                            QByteArray pt;
+                            pt.append(x);
+                            pt.append(y);
+                            setup.append({ color, pt });
+                        }
+                    }
+                } else {
+                    setup.append({ color, value });
+                }
+            } else if (ident == "SZ") {
+                int colon = value.indexOf(':');
+                game->boardSize = (colon >= 0 ? value.left(colon) : value).trimmed().toInt();
+            } else if (ident == "KM") {
+                bool ok = false;
+                double komi = value.trimmed().toDouble(&ok);
+                if (ok) game->komi = komi;
+            } else if (ident == "RU") {
+                game->rules = QString::fromUtf8(value).trimmed();
+            } else if (ident == "PL") {
+                game->initialPlayer = (value.trimmed().toUpper() == "W") ? 2 : 1;
+            }
+            continue;
+        }
+        if (c >= 'A' && c <= 'Z') {
+            // 新的属性名 (FF[3] 中夹杂的小写字母忽略)
+            ident.clear();
+            while (pos < n && ((data[pos] >= 'A' && data[pos] <= 'Z') || (data[pos] >= 'a' && data[pos] <= 'z'))) {
+                if (data[pos] >= 'A' && data[pos] <= 'Z') ident.append(data[pos]);
+                ++pos;
+            }
+            continue;
+        }
+        // ';' '(' 与空白: 节点/变化分隔, 主分支读取时无需区分
+        ++pos;
+    }
+
+    if (game->boardSize < 2 || game->boardSize > 25) {
+        return fail(QStringLiteral("不支持的棋盘大小: %1").arg(game->boardSize));
+    }
+
+    for (const RawMove &raw : setup) {
+        SgfMove m;
+        m.color = raw.color;
+        if (!parsePoint(raw.value, game->boardSize, &m.i, &m.j) || m.isPass()) {
+            return fail(QStringLiteral("无效的摆子坐标: %1").arg(QString::fromLatin1(raw.value)));
+        }
+        game->setup.append(m);
+    }
+    for (const RawMove &raw : moves) {
+        SgfMove m;
+        m.color = raw.color;
+        if (!parsePoint(raw.value, game->boardSize, &m.i, &m.j)) {
+            return fail(QStringLiteral("无效的着法坐标: %1").arg(QString::fromLatin1(raw.value)));
+        }
+        game->moves.append(m);
+    }
+    return true;
+}
@@ -0,0 +1,42 @@
+#ifndef SGFREADER_H
+#define SGFREADER_H
+
+#include <QString>
+#include <QVector>
+#include <QByteArray>
+
+/*
+ SgfReader: 读取 SGF 棋谱的主分支
+  - 只解析分析需要的属性: SZ, KM, RU, PL, AB/AW (摆子), B/W (着法)
+  - 变化图只沿第一个分支 (即主分支) 读取
+  - 坐标换算为与 Goban 一致的 (i 行, j 列), 虚着为 (-1, -1)
+*/
+struct SgfMove {
+    int color = 1; // 1=黑, 2=白
+    int i = -1;
+    int j = -1;
+    bool isPass() const { return i < 0; }
+};
+
+struct SgfGame {
+    int boardSize = 19;
+    double komi = 7.5;
+    QString rules;               // SGF 中的原始规则名, 可为空
+    int initialPlayer = 0;       // PL 属性, 0 表示未指定
+    QVector<SgfMove> setup;      // 摆子 (让子等)
+    QVector<SgfMove> moves;
+};
+
+class SgfReader
+{
+public:
+    // 解析 SGF 文本; 失败时返回 false 并写入 err
+    static bool parse(const QByteArray &data, SgfGame *game, QString *err = nullptr);
+    static bool parseFile(const QString &path, SgfGame *game, QString *err = nullptr);
+
+private:
+    // SGF 坐标 ("pd") 转为 (i, j); 空值或 "tt" (19 路以内) 表示虚着
+    static bool parsePoint(const QByteArray &value, int boardSize, int *i, int *j);
+};
+
+#endif // SGFREADER_H
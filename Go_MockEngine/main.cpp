@@ -0,0 +1,363 @@
+/*
+ mock_engine: 本地替身引擎, 用于在没有 KataGo / GPU 的机器上测量引擎通信链路的延迟与吞吐
+  - 命令行与 KataGo 相同: "mock_engine gtp ..." 或 "mock_engine analysis ...", 不认识的参数 (-model/-config 等) 忽略
+  - --think-ms N   每次 genmove / 每个分析局面的"思考"时间 (默认 100)
+  - --startup-ms N 模拟模型加载时间, 之后才输出就绪日志 (默认 0)
+  - --threads N    分析模式下并行处理请求的线程数 (默认 1)
+  - --seed N       随机数种子, 相同种子输出相同结果
+ GTP 模式支持带编号的命令并以空行结束响应; 分析模式支持 analyzeTurns、reportDuringSearchEvery、
+ includeOwnership 与 terminate 动作。输出的胜率/目差/着法为伪随机值, 只保证格式与 KataGo 一致。
+*/
+#include <QCoreApplication>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Options {
+    bool analysisMode = false;
+    int thinkMs = 100;
+    int startupMs = 0;
+    int threads = 1;
+    unsigned seed = 1;
+};
+
+std::mutex g_outMutex;
+
+void writeOut(const std::string &text)
+{
+    std::lock_guard<std::mutex> lock(g_outMutex);
+    std::fwrite(text.data(), 1, text.size(), stdout);
+    std::fflush(stdout);
+}
+
+void sleepMs(int ms)
+{
+    if (ms > 0) std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+// 与 EngineConnection::gtpVertex 相同的坐标规则 (跳过字母 I, 行号自下而上)
+std::string vertex(int i, int j, int n)
+{
+    char col = char('A' + j);
+    if (col >= 'I') ++col;
+    return std::string(1, col) + std::to_string(n - i);
+}
+
+bool parseVertex(const std::string &v, int n, int *i, int *j)
+{
+    if (v.size() < 2) return false;
+    char c = char(std::toupper(static_cast<unsigned char>(v[0])));
+    if (c < 'A' || c > 'Z' || c == 'I') return false;
+    int col = c - 'A' - (c > 'I' ? 1 : 0);
+    int row = std::atoi(v.c_str() + 1);
+    int r = n - row;
+    if (r < 0 || r >= n || col < 0 || col >= n) return false;
+    *i = r;
+    *j = col;
+    return true;
+}
+
+// ---------------- GTP 模式 ----------------
+
+int runGtp(const Options &opt)
+{
+    std::mt19937 rng(opt.seed);
+    int n = 19;
+    std::vector<char> board(size_t(n * n), 0);
+
+    sleepMs(opt.startupMs);
+    std::fprintf(stderr, "GTP ready, beginning main protocol loop\n");
+    std::fflush(stderr);
+
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        size_t pos = line.find_first_not_of(" \t");
+        if (pos == std::string::npos) continue;
+
+        // 可选的命令编号
+        std::string id;
+        while (pos < line.size() && std::isdigit(static_cast<unsigned char>(line[pos]))) id += line[pos++];
+        std::vector<std::string> args;
+        size_t k = pos;
+        while (k < line.size()) {
+            while (k < line.size() && std::isspace(static_cast<unsigned char>(line[k]))) ++k;
+            size_t start = k;
+            while (k < line.size() && !std::isspace(static_cast<unsigned char>(line[k]))) ++k;
+            if (k > start) args.push_back(line.substr(start, k - start));
+        }
+        if (args.empty()) continue;
+        const std::string &cmd = args[0];
+
+        bool ok = true;
+        std::string payload;
+        if (cmd == "quit") {
+            writeOut("=" + id + "\n\n");
+            return 0;
+        } else if (cmd == "name") {
+            payload = "MockEngine";
+        } else if (cmd == "version") {
+            payload = "1.0";
+        } else if (cmd == "protocol_version") {
+            payload = "2";
+        } else if (cmd == "list_commands") {
+            payload = "boardsize\nclear_board\ngenmove\nkomi\nlist_commands\nname\nplay\nprotocol_version\nquit\nversion";
+        } else if (cmd == "boardsize") {
+            int size = args.size() > 1 ? std::atoi(args[1].c_str()) : 0;
+            if (size < 2 || size > 25) {
+                ok = false;
+                payload = "unacceptable size";
+            } else {
+                n = size;
+                board.assign(size_t(n * n), 0);
+            }
+        } else if (cmd == "clear_board") {
+            board.assign(size_t(n * n), 0);
+        } else if (cmd == "play") {
+            int i = 0, j = 0;
+            if (args.size() > 2 && parseVertex(args[2], n, &i, &j)) board[size_t(i * n + j)] = 1;
+        } else if (cmd == "genmove") {
+            sleepMs(opt.thinkMs);
+            std::vector<int> empty;
+            for (int p = 0; p < n * n; ++p) if (!board[size_t(p)]) empty.push_back(p);
+            if (empty.empty()) {
+                payload = "pass";
+            } else {
+                int p = empty[std::uniform_int_distribution<size_t>(0, empty.size() - 1)(rng)];
+                board[size_t(p)] = 1;
+                payload = vertex(p / n, p % n, n);
+            }
+        }
+        // 其余命令 (komi 等) 一律视为成功
+
+        std::string resp = (ok ? "=" : "?") + id;
+        if (!payload.empty()) resp += " " + payload;
+        resp += "\n\n";
+        writeOut(resp);
+    }
+    return 0;
+}
+
+// ---------------- 分析模式 ----------------
+
+class AnalysisEngine
+{
+public:
+    explicit AnalysisEngine(const Options &opt) : m_opt(opt) {}
+
+    int run()
+    {
+        sleepMs(m_opt.startupMs);
+        std::fprintf(stderr, "Started, ready to begin handling requests\n");
+        std::fflush(stderr);
+
+        std::vector<std::thread> workers;
+        for (int t = 0; t < std::max(1, m_opt.threads); ++t) {
+            workers.emplace_back([this, t]() { workerLoop(m_opt.seed + unsigned(t)); });
+        }
+
+        // 主线程负责读取; terminate 立即生效, 不排在其它请求之后
+        std::string line;
+        while (std::getline(std::cin, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line == "quit") break;
+            if (line.find_first_not_of(" \t") == std::string::npos) continue;
+
+            QJsonParseError err;
+            QJsonDocument doc = QJsonDocument::fromJson(QByteArray::fromStdString(line), &err);
+            if (err.error != QJsonParseError::NoError || !doc.isObject()) {
+                QJsonObject e;
+                e["error"] = QString("Could not parse json: %1").arg(err.errorString());
+                emitJson(e);
+                continue;
+            }
+            QJsonObject q = doc.object();
+            if (q.value("action").toString() == "terminate") {
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_terminated.insert(q.value("terminateId").toString().toStdString());
+                }
+                emitJson(q);
+                continue;
+            }
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_queue.push_back(q);
+            }
+            m_cond.notify_one();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_eof = true;
+        }
+        m_cond.notify_all();
+        for (std::thread &w : workers) w.join();
+        return 0;
+    }
+
+private:
+    static void emitJson(const QJsonObject &obj)
+    {
+        writeOut(QJsonDocument(obj).toJson(QJsonDocument::Compact).toStdString() + "\n");
+    }
+
+    bool isTerminated(const std::string &id)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_terminated.count(id) > 0;
+    }
+
+    void workerLoop(unsigned seed)
+    {
+        std::mt19937 rng(seed);
+        for (;;) {
+            QJsonObject q;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_cond.wait(lock, [this]() { return m_eof || !m_queue.empty(); });
+                if (m_queue.empty()) return;
+                q = m_queue.front();
+                m_queue.pop_front();
+            }
+            handleQuery(q, rng);
+        }
+    }
+
+    void handleQuery(const QJsonObject &q, std::mt19937 &rng)
+    {
+        const QString id = q.value("id").toString();
+        const int n = q.value("boardXSize").toInt(19);
+        if (id.isEmpty() || !q.value("moves").isArray() || n < 2 || n > 25) {
+            QJsonObject e;
+            e["id"] = id;
+            e["error"] = "Missing or invalid field";
+            emitJson(e);
+            return;
+        }
+
+        const int moveCount = q.value("moves").toArray().size();
+        std::vector<int> turns;
+        if (q.contains("analyzeTurns")) {
+            for (const auto &t : q.value("analyzeTurns").toArray()) turns.push_back(t.toInt());
+        } else {
+            turns.push_back(moveCount);
+        }
+        const int maxVisits = q.value("maxVisits").toInt(500);
+        const bool ownership = q.value("includeOwnership").toBool(false);
+        const int reportMs = int(q.value("reportDuringSearchEvery").toDouble(0.0) * 1000.0);
+        const std::string sid = id.toStdString();
+
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+        for (int turn : turns) {
+            // 思考时间按 reportDuringSearchEvery 切片, 每片之间输出中间结果并检查是否被终止
+            int elapsed = 0;
+            bool terminated = false;
+            while (elapsed < m_opt.thinkMs) {
+                int slice = reportMs > 0 ? std::min(reportMs, m_opt.thinkMs - elapsed) : std::min(5, m_opt.thinkMs - elapsed);
+                sleepMs(slice);
+                elapsed += slice;
+                if (isTerminated(sid)) {
+                    terminated = true;
+                    break;
+                }
+                if (reportMs > 0 && elapsed < m_opt.thinkMs) {
+                    int visits = std::max(1, int(qint64(maxVisits) * elapsed / m_opt.thinkMs));
+                    emitJson(result(id, turn, n, visits, true, ownership, rng, unit));
+                }
+            }
+            if (terminated) return;
+            emitJson(result(id, turn, n, maxVisits, false, ownership, rng, unit));
+        }
+    }
+
+    static QJsonObject result(const QString &id, int turn, int n, int visits, bool duringSearch, bool ownership,
+                              std::mt19937 &rng, std::uniform_real_distribution<double> &unit)
+    {
+        double winrate = unit(rng);
+        double scoreLead = (winrate - 0.5) * 40.0;
+        int best = std::uniform_int_distribution<int>(0, n * n - 1)(rng);
+
+        QJsonObject rootInfo;
+        rootInfo["winrate"] = winrate;
+        rootInfo["scoreLead"] = scoreLead;
+        rootInfo["visits"] = visits;
+
+        QJsonObject move;
+        move["move"] = QString::fromStdString(vertex(best / n, best % n, n));
+        move["order"] = 0;
+        move["visits"] = visits;
+        move["winrate"] = winrate;
+        move["scoreLead"] = scoreLead;
+
+        QJsonObject out;
+        out["id"] = id;
+        out["turnNumber"] = turn;
+        out["isDuringSearch"] = duringSearch;
+        out["rootInfo"] = rootInfo;
+        out["moveInfos"] = QJsonArray{ move };
+        if (ownership) {
+            QJsonArray own;
+            for (int p = 0; p < n * n; ++p) own.append(unit(rng) * 2.0 - 1.0);
+            out["ownership"] = own;
+        }
+        return out;
+    }
+
+    const Options m_opt;
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::deque<QJsonObject> m_queue;
+    std::set<std::string> m_terminated;
+    bool m_eof = false;
+};
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    Options opt;
+    const QStringList args = a.arguments();
+    for (int k = 1; k < args.size(); ++k) {
+        const QString &arg = args[k];
+        auto intValue = [&](int *target) {
+            if (k + 1 < args.size()) *target = args[++k].toInt();
+        };
+        if (arg == "analysis") opt.analysisMode = true;
+        else if (arg == "gtp") opt.analysisMode = false;
+        else if (arg == "--think-ms") intValue(&opt.thinkMs);
+        else if (arg == "--startup-ms") intValue(&opt.startupMs);
+        else if (arg == "--threads") intValue(&opt.threads);
+        else if (arg == "--seed" && k + 1 < args.size()) opt.seed = args[++k].toUInt();
+        // 其余参数 (如 -model/-config) 与 KataGo 兼容, 忽略
+    }
+    opt.thinkMs = std::max(0, opt.thinkMs);
+
+    if (opt.analysisMode) {
+        AnalysisEngine engine(opt);
+        return engine.run();
+    }
+    return runGtp(opt);
+}
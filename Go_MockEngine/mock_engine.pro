@@ -0,0 +1,8 @@
+QT += core
+QT -= gui
+CONFIG += c++11 console thread
+CONFIG -= app_bundle
+TARGET = mock_engine
+TEMPLATE = app
+
+SOURCES += main.cpp
@@ -5,16 +5,41 @@
 #include <QDebug>
 #include <QJsonArray>
 #include <QDateTime>
+#include <QTimer>
+#include <QThread>
+
+namespace {
+// 断线后保留座位与房间的时长; 客户端的重连窗口略短于此
+const int kResumeGraceMs = 60000;
+// 每收到这么多条消息回执一次, 供对方释放补发队列
+const quint64 kAckInterval = 32;
+// 单个玩家补发队列上限, 超出后丢弃最旧的消息 (此后该会话无法再恢复到更早的位置)
+const int kOutboxLimit = 1024;
+// 贴目 (中国规则贴 3¾ 子)
+const double kKomi = 7.5;
+
+const QString kLobbyTopic = QStringLiteral("lobby");
+QString roomTopic(const QString &roomId) { return QStringLiteral("room:") + roomId; }
+QString spectateTopic(const QString &roomId) { return QStringLiteral("spectate:") + roomId; }
+}
 
 GameServer::GameServer(QObject *parent) : QObject(parent)
 {
-    m_server = new QWebSocketServer(QStringLiteral("GoCentralServer"),
-                                    QWebSocketServer::NonSecureMode, this);
+    // 认证对象移到数据库线程, 数据库连接也在该线程中建立和使用
+    m_dbThread = new QThread(this);
+    m_auth = new AuthManager;
+    m_auth->moveToThread(m_dbThread);
+    connect(m_dbThread, &QThread::finished, m_auth, &QObject::deleteLater);
+    m_dbThread->start();
 }
 
 GameServer::~GameServer()
 {
     stopServer();
+    // 等已排队的战绩写入执行完再退出数据库线程
+    QMetaObject::invokeMethod(m_auth, []() {}, Qt::BlockingQueuedConnection);
+    m_dbThread->quit();
+    m_dbThread->wait();
 }
 
 bool GameServer::initAuthDB(const QString &dbHost, int dbPort,
@@ -23,34 +48,73 @@ bool GameServer::initAuthDB(const QString &dbHost, int dbPort,
                             const QString &dbPassword,
                             QString &errMsg)
 {
-    return m_auth.openDatabase(dbHost, dbPort, dbName, dbUser, dbPassword, errMsg);
+    bool ok = false;
+    QMetaObject::invokeMethod(m_auth, [&]() {
+        ok = m_auth->openDatabase(dbHost, dbPort, dbName, dbUser, dbPassword, errMsg);
+    }, Qt::BlockingQueuedConnection);
+    return ok;
 }
 
-bool GameServer::startServer(quint16 port)
+bool GameServer::startServer(quint16 port, int workers)
 {
-    if (!m_server) return false;
-    if (!m_server->listen(QHostAddress::Any, port)) {
+    if (m_listener) return false;
+    if (workers <= 0) workers = qMax(1, QThread::idealThreadCount());
+
+    m_listener = new ShardListener(this);
+    if (!m_listener->listen(QHostAddress::Any, port)) {
         qWarning() << "无法监听端口" << port;
+        delete m_listener;
+        m_listener = nullptr;
         return false;
     }
-    connect(m_server, &QWebSocketServer::newConnection, this, &GameServer::onNewConnection);
-    qDebug() << "游戏服务器已启动, 端口:" << port;
+
+    for (int i = 0; i < workers; ++i) {
+        QThread* thread = new QThread;
+        ConnectionShard* shard = new ConnectionShard(i, this);
+        shard->moveToThread(thread);
+        connect(thread, &QThread::finished, shard, &QObject::deleteLater);
+        thread->start();
+        QMetaObject::invokeMethod(shard, &ConnectionShard::init, Qt::QueuedConnection);
+        m_shardThreads.append(thread);
+        m_shards.append(shard);
+    }
+    connect(m_listener, &ShardListener::descriptorReady, this, &GameServer::onIncomingDescriptor);
+    qDebug() << "游戏服务器已启动, 端口:" << port << "连接线程数:" << workers;
     return true;
 }
 
 void GameServer::stopServer()
 {
-    if (!m_server) return;
-    m_server->close();
-    disconnect(m_server, &QWebSocketServer::newConnection, this, &GameServer::onNewConnection);
-
-    // 清理所有玩家连接和数据
-    for (auto it = m_map.begin(); it != m_map.end(); ++it) {
-        QWebSocket* sock = it.key();
-        Player* pl = it.value();
-        if (sock) { sock->close(); sock->deleteLater(); }
+    if (!m_listener) return;
+    m_listener->close();
+    delete m_listener;
+    m_listener = nullptr;
+
+    // 关闭所有连接并结束分片线程
+    for (ConnectionShard* shard : qAsConst(m_shards)) {
+        QMetaObject::invokeMethod(shard, &ConnectionShard::closeAll, Qt::BlockingQueuedConnection);
+    }
+    for (QThread* thread : qAsConst(m_shardThreads)) {
+        thread->quit();
+        thread->wait();
+        delete thread;
+    }
+    m_shardThreads.clear();
+    m_shards.clear();
+    // 丢弃分片尚未交给主线程的事件
+    ShardEvent ev;
+    while (m_inbound.pop(&ev)) {}
+
+    // 断线保留中的玩家不在 m_map 中, 先单独释放
+    for (Player* pl : qAsConst(m_sessions)) {
+        if (pl->conn) continue;
+        delete pl->graceTimer;
         delete pl;
     }
+    m_sessions.clear();
+
+    // 清理所有在线玩家
+    for (Player* pl : qAsConst(m_map)) delete pl;
     m_map.clear();
 
     // 清理所有房间数据
@@ -58,53 +122,121 @@ void GameServer::stopServer()
         delete it.value();
     }
     m_rooms.clear();
+    m_topics.clear();
     while (!m_waiting.isEmpty()) m_waiting.dequeue();
 }
 
-void GameServer::onNewConnection()
+void GameServer::onIncomingDescriptor(qintptr fd)
 {
-    QWebSocket* sock = m_server->nextPendingConnection();
-    Player* pl = new Player;
-    pl->id = QUuid::createUuid().toString();
-    pl->socket = sock;
-    pl->roomId.clear();
-    pl->isBlack = false;
-    pl->ready = false;
-    pl->userId = 0;
-
-    m_map.insert(sock, pl);
+    if (m_shards.isEmpty()) return;
+    ConnectionShard* shard = m_shards.at(m_nextShard);
+    m_nextShard = (m_nextShard + 1) % m_shards.size();
+    QMetaObject::invokeMethod(shard, [shard, fd]() { shard->adoptDescriptor(fd); }, Qt::QueuedConnection);
+}
 
-    connect(sock, &QWebSocket::textMessageReceived, this, &GameServer::onTextMessageReceived);
-    connect(sock, &QWebSocket::disconnected, this, &GameServer::onSocketDisconnected);
+void GameServer::postEvent(ShardEvent ev)
+{
+    m_inbound.push(std::move(ev));
+    // 入队之后再检查标志: 已有未执行的唤醒时不重复投递
+    if (!m_drainScheduled.exchange(true)) {
+        QMetaObject::invokeMethod(this, &GameServer::drainInbound, Qt::QueuedConnection);
+    }
+}
 
-    qDebug() << "新玩家连接:" << pl->id << sock->peerAddress().toString();
+void GameServer::drainInbound()
+{
+    // 先清标志再取: 此后入队的事件一定会再投递一次唤醒
+    m_drainScheduled.store(false);
+    ShardEvent ev;
+    while (m_inbound.pop(&ev)) handleShardEvent(ev);
 }
 
-void GameServer::onTextMessageReceived(const QString &message)
+void GameServer::handleShardEvent(const ShardEvent &ev)
 {
-    QWebSocket* sock = qobject_cast<QWebSocket*>(sender());
-    if (!sock || !m_map.contains(sock)) return;
-    Player* pl = m_map[sock];
+    if (ev.kind == ShardEvent::Opened) {
+        Player* pl = new Player;
+        pl->id = QUuid::createUuid().toString();
+        pl->conn = ev.conn;
+        pl->shard = ev.shard;
+        m_map.insert(ev.conn, pl);
+        qDebug() << "新玩家连接:" << pl->id << ev.peer << "分片" << ev.shard->index();
+        return;
+    }
+    if (ev.kind == ShardEvent::Closed) {
+        onConnectionClosed(ev.conn);
+        return;
+    }
+    // 已被接管或关闭的连接上残留的消息直接丢弃
+    Player* pl = m_map.value(ev.conn, nullptr);
+    if (pl) dispatchMessage(pl, ev);
+}
 
-    QJsonParseError perr;
-    QJsonDocument doc = QJsonDocument::fromJson(message.toUtf8(), &perr);
-    if (perr.error != QJsonParseError::NoError || !doc.isObject()) {
-        sendToPlayer(pl, QJsonObject{{"type","error"},{"msg","非法的JSON格式"}});
+void GameServer::dispatchMessage(Player* pl, const ShardEvent &ev)
+{
+    const bool ok = ev.kind == ShardEvent::Message;
+    // 无法解析的消息也计数, 与客户端的发送计数保持一致
+    if (!ok || !WireCodec::isControl(ev.obj.value("type").toString())) {
+        ++pl->recvCount;
+        if (!pl->resumeToken.isEmpty() && pl->recvCount - pl->recvAcked >= kAckInterval) {
+            pl->recvAcked = pl->recvCount;
+            sendControl(pl, QJsonObject{{"type","ack"},{"received", double(pl->recvCount)}});
+        }
+    }
+    if (!ok) {
+        sendToPlayer(pl, QJsonObject{{"type","error"},{"msg", ev.binary ? "非法的二进制消息" : "非法的JSON格式"}});
         return;
     }
-    QJsonObject obj = doc.object();
+    EncodedMessage in;
+    in.obj = ev.obj;
+    (ev.binary ? in.cbor : in.json) = ev.raw;
+    handleMessage(pl, in);
+}
+
+void GameServer::handleMessage(Player* pl, EncodedMessage &in)
+{
+    const QJsonObject &obj = in.obj;
     QString type = obj.value("type").toString();
 
+    // 编码协商: 确认消息仍以 JSON 发送, 之后对该玩家改用协商出的编码
+    if (type == "hello") {
+        WireCodec::Format codec = WireCodec::negotiate(obj.value("codecs").toVariant().toStringList());
+        sendControl(pl, QJsonObject{{"type","hello_ack"},{"codec", WireCodec::formatName(codec)}});
+        pl->codec = codec;
+        return;
+    }
+
+    // 断线重连与消息回执
+    if (type == "resume") {
+        handleResume(pl, obj);
+        return;
+    }
+    if (type == "ack") {
+        acknowledge(pl, quint64(obj.value("received").toDouble()));
+        return;
+    }
+    if (type == "ping") {
+        handlePing(pl, obj);
+        return;
+    }
+
     // 注册
     if (type == "register") {
         QString username = obj.value("username").toString();
         QString password = obj.value("password").toString();
         QString nickname = obj.value("nickname").toString();
-        QJsonObject ret = m_auth.registerUser(username, password, nickname);
-        QJsonObject resp;
-        resp["type"] = "register_result";
-        for (auto it = ret.begin(); it != ret.end(); ++it) resp[it.key()] = it.value();
-        sendToPlayer(pl, resp);
+        const quint64 conn = pl->conn;
+        const QString pid = pl->id;
+        runOnDb([username, password, nickname](AuthManager* auth) {
+            return auth->registerUser(username, password, nickname);
+        }, [this, conn, pid](const QJsonObject &ret) {
+            // 查询期间连接可能已断开
+            Player* pl = m_map.value(conn, nullptr);
+            if (!pl || pl->id != pid) return;
+            QJsonObject resp;
+            resp["type"] = "register_result";
+            for (auto it = ret.begin(); it != ret.end(); ++it) resp[it.key()] = it.value();
+            sendToPlayer(pl, resp);
+        });
         return;
     }
 
@@ -112,44 +244,15 @@ void GameServer::onTextMessageReceived(const QString &message)
     if (type == "login") {
         QString username = obj.value("username").toString();
         QString password = obj.value("password").toString();
-        QJsonObject ret = m_auth.loginUser(username, password);
-        QJsonObject resp;
-        resp["type"] = "login_result";
-        if (!ret.value("success").toBool()) {
-            resp["success"] = false;
-            resp["msg"] = ret.value("msg").toString();
-            sendToPlayer(pl, resp);
-            return;
-        }
-        // 登录成功: 检查此账号是否已在别处登录 (防多开)
-        QJsonObject user = ret.value("user").toObject();
-        int incomingId = user.value("id").toInt();
-        for (auto it = m_map.begin(); it != m_map.end(); ++it) {
-            Player* other = it.value();
-            if (other == pl) continue;
-            if (other && other->userId == incomingId) {
-                // 发现重复登录, 拒绝本次请求
-                resp["success"] = false;
-                resp["msg"] = QStringLiteral("该账号已在其他设备登录");
-                sendToPlayer(pl, resp);
-                return;
-            }
-        }
-
-        // 填充玩家信息
-        pl->userId = user.value("id").toInt();
-        pl->username = username;
-        pl->nickname = user.value("nickname").toString();
-        pl->rating = user.value("rating").toInt();
-        pl->wins = user.value("wins").toInt();
-        pl->losses = user.value("losses").toInt();
-
-        resp["success"] = true;
-        resp["user"] = user;
-        sendToPlayer(pl, resp);
-
-        // 登录后立即发送当前房间列表
-        sendRoomListToPlayer(pl);
+        const quint64 conn = pl->conn;
+        const QString pid = pl->id;
+        runOnDb([username, password](AuthManager* auth) {
+            return auth->loginUser(username, password);
+        }, [this, conn, pid, username](const QJsonObject &ret) {
+            Player* pl = m_map.value(conn, nullptr);
+            if (!pl || pl->id != pid) return;
+            completeLogin(pl, username, ret);
+        });
         return;
     }
 
@@ -161,6 +264,10 @@ void GameServer::onTextMessageReceived(const QString &message)
         pl->nickname.clear();
         pl->rating = 1200;
         pl->wins = pl->losses = 0;
+        m_sessions.remove(pl->resumeToken);
+        pl->resumeToken.clear();
+        pl->outbox.clear();
+        unsubscribe(pl, kLobbyTopic);
         sendToPlayer(pl, QJsonObject{{"type","logout_result"},{"success",true}});
         return;
     }
@@ -198,6 +305,22 @@ void GameServer::onTextMessageReceived(const QString &message)
         return;
     }
 
+    // 订阅/退订客户端正在显示的内容; 目前客户端可直接订阅的只有大厅 (观战使用 spectate)
+    if (type == "subscribe" || type == "unsubscribe") {
+        const QString topic = obj.value("topic").toString();
+        if (topic != kLobbyTopic) {
+            sendToPlayer(pl, QJsonObject{{"type","error"},{"msg","无法订阅该主题"}});
+            return;
+        }
+        if (type == "subscribe" && pl->userId == 0) {
+            sendToPlayer(pl, QJsonObject{{"type","error"},{"msg","请先登录"}});
+            return;
+        }
+        if (type == "subscribe") sendRoomListToPlayer(pl);
+        else unsubscribe(pl, topic);
+        return;
+    }
+
     // 匹配
     if (type == "match") {
         if (pl->userId == 0) {
@@ -217,6 +340,40 @@ void GameServer::onTextMessageReceived(const QString &message)
         return;
     }
 
+    // 观战: 之后该房间的对局消息也会转发给观战者
+    if (type == "spectate" || type == "unspectate") {
+        if (pl->userId == 0) {
+            sendToPlayer(pl, QJsonObject{{"type","error"},{"msg","请先登录"}});
+            return;
+        }
+        QString rid = obj.value("room_id").toString();
+        Room* target = m_rooms.value(rid, nullptr);
+        if (type == "unspectate") {
+            unsubscribe(pl, spectateTopic(rid));
+            return;
+        }
+        if (!target) {
+            sendToPlayer(pl, QJsonObject{{"type","spectate_result"},{"room_id",rid},{"success",false},{"msg","房间不存在"}});
+            return;
+        }
+        subscribe(pl, spectateTopic(rid));
+        sendToPlayer(pl, QJsonObject{{"type","spectate_result"},{"room_id",rid},{"success",true}});
+        // 新观战者先收一次全量盘面, 之后只收增量
+        sendSnapshot(target, pl);
+        return;
+    }
+
+    // 全量同步请求: 观战者带 room_id 指定房间; 均由服务端盘面直接回复
+    if (type == "resync_request") {
+        QString rid = obj.value("room_id").toString();
+        if (!rid.isEmpty() && pl->topics.contains(spectateTopic(rid))) {
+            sendSnapshot(m_rooms.value(rid, nullptr), pl);
+        } else {
+            sendSnapshot(getRoomForPlayer(pl), pl);
+        }
+        return;
+    }
+
     Room* room = getRoomForPlayer(pl);
 
     // 聊天消息
@@ -234,9 +391,10 @@ void GameServer::onTextMessageReceived(const QString &message)
         out["room_id"] = room->id;
         out["time"] = QDateTime::currentDateTime().toString(Qt::ISODate);
 
-        // 广播给房间内的所有玩家 (包括自己)
-        if (room->p1 && room->p1->socket) sendToPlayer(room->p1, out);
-        if (room->p2 && room->p2->socket && room->p2 != room->p1) sendToPlayer(room->p2, out);
+        // 广播给房间内的所有玩家 (包括自己); 断线中的玩家重连后补收
+        EncodedMessage msg;
+        msg.obj = out;
+        publish(roomTopic(room->id), msg);
         return;
     }
 
@@ -260,6 +418,7 @@ void GameServer::onTextMessageReceived(const QString &message)
                 sendToPlayer(other, QJsonObject{{"type","opponent_left"},{"room_id", room->id}});
                 other->roomId.clear();
             }
+            closeRoomTopics(room);
             m_rooms.remove(room->id);
             delete room;
             broadcastRoomList();
@@ -269,56 +428,79 @@ void GameServer::onTextMessageReceived(const QString &message)
         return;
     }
 
+    // 增量落子: 先校验轮次与序号, 再转发
+    if (type == "delta") {
+        if (!room) {
+            sendToPlayer(pl, QJsonObject{{"type","error"},{"msg","未在房间内"}}); return;
+        }
+        handleDelta(pl, room, obj);
+        return;
+    }
+
+    // 盘面以服务端为准, 客户端的全量同步与新局消息不再转发
+    if (type == "sync" || type == "newgame") return;
+
     // 游戏内消息转发 (落子, 虚着, 认输等)
-    if (type == "move" || type == "pass" || type == "turn" ||
-        type == "resign" || type == "sync" || type == "newgame" )
+    if (type == "move" || type == "pass" || type == "turn" || type == "resign")
     {
         if (!room) {
             sendToPlayer(pl, QJsonObject{{"type","error"},{"msg","未在房间内"}}); return;
         }
+        // 旧版客户端的 move/pass 同样先在服务端盘面上校验
+        if (type == "move" || type == "pass") {
+            int x = type == "pass" ? -1 : obj.value("x").toInt(-1);
+            int y = type == "pass" ? -1 : obj.value("y").toInt(-1);
+            QString err;
+            if (type == "move" && (x < 0 || y < 0)) err = QStringLiteral("缺少落子坐标");
+            if (!err.isEmpty() || !playOnRoomBoard(pl, room, x, y, &err)) {
+                sendToPlayer(pl, QJsonObject{{"type","error"},{"msg", err}});
+                return;
+            }
+            ++room->seq;
+        }
+        if (type == "resign" && !room->playing) {
+            sendToPlayer(pl, QJsonObject{{"type","error"},{"msg","对局未在进行"}}); return;
+        }
+        sendToSpectators(room, obj);
+        // 以下均把客户端的原始消息转发给对手
         if (type == "resign") {
-            sendToOpponent(pl, obj);
+            sendToOpponent(pl, in);
+            room->playing = false;
+            room->endRequestedBy = nullptr;
             room->p1Ready = false;
             room->p2Ready = false;
             // 更新数据库战绩
             Player* other = (room->p1 == pl ? room->p2 : room->p1);
-            if (pl->userId != 0) { QString e; m_auth.updateResult(pl->userId, false, e); }
-            if (other && other->userId != 0) { QString e; m_auth.updateResult(other->userId, true, e); }
+            if (pl->userId != 0) recordResult(pl->userId, false);
+            if (other && other->userId != 0) recordResult(other->userId, true);
             broadcastRoomList(); // 广播房间列表以更新段位显示
             return;
         }
-        sendToOpponent(pl, obj);
+        sendToOpponent(pl, in);
         return;
     }
 
     // 点目请求/确认/拒绝
     if (type == "end_request") {
         if (!room) { sendToPlayer(pl, QJsonObject{{"type","error"},{"msg","未在房间内"}}); return; }
-        sendToOpponent(pl, obj);
+        if (!room->playing) { sendToPlayer(pl, QJsonObject{{"type","error"},{"msg","对局未在进行"}}); return; }
+        room->endRequestedBy = pl;
+        sendToOpponent(pl, in);
         return;
     }
     if (type == "end_confirm") {
         if (!room) { sendToPlayer(pl, QJsonObject{{"type","error"},{"msg","未在房间内"}}); return; }
-        // 广播给双方
-        sendToOpponent(pl, obj);
-        sendToPlayer(pl, obj);
-
-        // 可选: 如果客户端在消息中附加了胜负方ID, 则更新数据库
-        if (obj.contains("winner_userid")) {
-            int wid = obj.value("winner_userid").toInt();
-            int lid = obj.value("loser_userid").toInt();
-            QString e;
-            if (wid != 0) m_auth.updateResult(wid, true, e);
-            if (lid != 0) m_auth.updateResult(lid, false, e);
+        // 只能确认对方发起的点目请求; 胜负由服务端点目决定, 忽略客户端附带的胜负信息
+        if (!room->playing || !room->endRequestedBy || room->endRequestedBy == pl) {
+            sendToPlayer(pl, QJsonObject{{"type","error"},{"msg","没有待确认的点目请求"}}); return;
         }
-        room->p1Ready = false;
-        room->p2Ready = false;
-        broadcastRoomList();
+        finishByScore(room);
         return;
     }
     if (type == "end_decline") {
         if (!room) { sendToPlayer(pl, QJsonObject{{"type","error"},{"msg","未在房间内"}}); return; }
-        sendToOpponent(pl, obj);
+        if (room->endRequestedBy != pl) room->endRequestedBy = nullptr;
+        sendToOpponent(pl, in);
         return;
     }
 
@@ -351,6 +533,8 @@ void GameServer::handleMatch(Player* pl)
         pl->ready = false;
 
         m_rooms.insert(r->id, r);
+        seatPlayer(other, r);
+        seatPlayer(pl, r);
 
         // 构造包含完整玩家信息 (包括胜负场) 的JSON对象
         QJsonObject m1;
@@ -420,6 +604,7 @@ void GameServer::handleCreateRoom(Player* pl)
     pl->isBlack = true; // 房主默认执黑
     pl->ready = false;
     m_rooms.insert(r->id, r);
+    seatPlayer(pl, r);
 
     // 准备JSON消息, 包含"you"和空的"opponent"对象以保持格式一致
     QJsonObject jo;
@@ -458,6 +643,7 @@ void GameServer::handleJoinRoom(Player* pl, const QString &roomId)
     pl->roomId = roomId;
     pl->isBlack = false;
     pl->ready = false;
+    seatPlayer(pl, r);
 
     // 向加入者发送 "room_joined" 消息, 触发其进入房间界面
     QJsonObject jo2;
@@ -508,17 +694,143 @@ void GameServer::tryStartWhenReady(Room* room)
         QJsonObject s2{{"type","start"},{"color","white"}};
         sendToPlayer(room->p1, s1);
         sendToPlayer(room->p2, s2);
+        sendToSpectators(room, QJsonObject{{"type","start"}});
         room->p1Ready = false;
         room->p2Ready = false;
+        room->board.reset();
+        room->seq = 0;
+        room->playing = true;
+        room->endRequestedBy = nullptr;
         qDebug() << "房间开始:" << room->id;
     }
 }
 
 void GameServer::sendToPlayer(Player* pl, const QJsonObject &obj)
 {
-    if (!pl || !pl->socket) return;
-    QJsonDocument doc(obj);
-    pl->socket->sendTextMessage(QString::fromUtf8(doc.toJson(QJsonDocument::Compact)));
+    if (!pl) return;
+    trackOutgoing(pl, obj);
+    sendControl(pl, obj);
+}
+
+void GameServer::sendEncoded(Player* pl, EncodedMessage &msg)
+{
+    if (!pl) return;
+    trackOutgoing(pl, msg.obj);
+    if (!pl->conn) return;
+    ShardCommand cmd;
+    cmd.kind = ShardCommand::Send;
+    cmd.conn = pl->conn;
+    cmd.codec = pl->codec;
+    cmd.frame = msg.frame(pl->codec);
+    pl->shard->post(cmd);
+}
+
+void GameServer::trackOutgoing(Player* pl, const QJsonObject &obj)
+{
+    ++pl->sentCount;
+    if (!pl->resumeToken.isEmpty()) {
+        pl->outbox.append(obj);
+        if (pl->outbox.size() > kOutboxLimit) {
+            pl->outbox.removeFirst();
+            ++pl->outboxBase;
+        }
+    }
+}
+
+void GameServer::sendControl(Player* pl, const QJsonObject &obj)
+{
+    if (!pl || !pl->conn) return;
+    // 编码与写入在连接所在的分片线程完成
+    ShardCommand cmd;
+    cmd.kind = ShardCommand::Send;
+    cmd.conn = pl->conn;
+    cmd.obj = obj;
+    cmd.codec = pl->codec;
+    pl->shard->post(cmd);
+}
+
+void GameServer::closeConnection(Player* pl)
+{
+    if (!pl || !pl->conn) return;
+    ShardCommand cmd;
+    cmd.kind = ShardCommand::Close;
+    cmd.conn = pl->conn;
+    pl->shard->post(cmd);
+}
+
+void GameServer::runOnDb(std::function<QJsonObject(AuthManager*)> job,
+                         std::function<void(const QJsonObject&)> done)
+{
+    AuthManager* auth = m_auth;
+    QMetaObject::invokeMethod(auth, [this, auth, job, done]() {
+        const QJsonObject result = job(auth);
+        if (!done) return;
+        QMetaObject::invokeMethod(this, [done, result]() { done(result); }, Qt::QueuedConnection);
+    }, Qt::QueuedConnection);
+}
+
+void GameServer::recordResult(int userId, bool win)
+{
+    runOnDb([userId, win](AuthManager* auth) {
+        QString e;
+        if (!auth->updateResult(userId, win, e)) qWarning() << "战绩写入失败:" << userId << e;
+        return QJsonObject();
+    }, nullptr);
+}
+
+void GameServer::completeLogin(Player* pl, const QString &username, const QJsonObject &ret)
+{
+    QJsonObject resp;
+    resp["type"] = "login_result";
+    if (!ret.value("success").toBool()) {
+        resp["success"] = false;
+        resp["msg"] = ret.value("msg").toString();
+        sendToPlayer(pl, resp);
+        return;
+    }
+    // 登录成功: 检查此账号是否已在别处登录 (防多开)
+    QJsonObject user = ret.value("user").toObject();
+    int incomingId = user.value("id").toInt();
+    // 断线保留中的旧会话直接由本次登录取代
+    QList<Player*> stale;
+    for (Player* other : qAsConst(m_sessions)) {
+        if (!other->conn && other->userId == incomingId) stale.append(other);
+    }
+    for (Player* other : qAsConst(stale)) removePlayer(other);
+    for (auto it = m_map.begin(); it != m_map.end(); ++it) {
+        Player* other = it.value();
+        if (other == pl) continue;
+        if (other && other->userId == incomingId) {
+            // 发现重复登录, 拒绝本次请求
+            resp["success"] = false;
+            resp["msg"] = QStringLiteral("该账号已在其他设备登录");
+            sendToPlayer(pl, resp);
+            return;
+        }
+    }
+
+    // 填充玩家信息
+    pl->userId = user.value("id").toInt();
+    pl->username = username;
+    pl->nickname = user.value("nickname").toString();
+    pl->rating = user.value("rating").toInt();
+    pl->wins = user.value("wins").toInt();
+    pl->losses = user.value("losses").toInt();
+
+    // 签发恢复令牌, 之后发给该玩家的消息进入补发队列
+    m_sessions.remove(pl->resumeToken);
+    pl->resumeToken = QUuid::createUuid().toString(QUuid::WithoutBraces);
+    pl->outbox.clear();
+    pl->outboxBase = pl->sentCount;
+    m_sessions.insert(pl->resumeToken, pl);
+
+    resp["success"] = true;
+    resp["user"] = user;
+    resp["resume_token"] = pl->resumeToken;
+    sendToPlayer(pl, resp);
+
+    // 登录后立即发送当前房间列表
+    sendRoomListToPlayer(pl);
 }
 
 void GameServer::sendToOpponent(Player* pl, const QJsonObject &obj)
@@ -526,36 +838,203 @@ void GameServer::sendToOpponent(Player* pl, const QJsonObject &obj)
     if (!pl || pl->roomId.isEmpty() || !m_rooms.contains(pl->roomId)) return;
     Room* r = m_rooms[pl->roomId];
     Player* other = (r->p1 == pl ? r->p2 : r->p1);
-    if (other && other->socket) {
-        sendToPlayer(other, obj);
+    if (other) sendToPlayer(other, obj);
+}
+
+void GameServer::sendToOpponent(Player* pl, EncodedMessage &msg)
+{
+    if (!pl || pl->roomId.isEmpty() || !m_rooms.contains(pl->roomId)) return;
+    Room* r = m_rooms[pl->roomId];
+    Player* other = (r->p1 == pl ? r->p2 : r->p1);
+    if (other) sendEncoded(other, msg);
+}
+
+void GameServer::sendToSpectators(Room* room, QJsonObject obj)
+{
+    if (!room || !m_topics.contains(spectateTopic(room->id))) return;
+    obj["room_id"] = room->id;
+    EncodedMessage msg;
+    msg.obj = obj;
+    publish(spectateTopic(room->id), msg);
+}
+
+void GameServer::subscribe(Player* pl, const QString &topic)
+{
+    if (pl->topics.contains(topic)) return;
+    pl->topics.append(topic);
+    m_topics[topic].append(pl);
+}
+
+void GameServer::unsubscribe(Player* pl, const QString &topic)
+{
+    if (!pl->topics.removeOne(topic)) return;
+    auto it = m_topics.find(topic);
+    if (it == m_topics.end()) return;
+    it.value().removeOne(pl);
+    if (it.value().isEmpty()) m_topics.erase(it);
+}
+
+void GameServer::publish(const QString &topic, EncodedMessage &msg)
+{
+    const QList<Player*> subscribers = m_topics.value(topic);
+    for (Player* pl : subscribers) sendEncoded(pl, msg);
+}
+
+void GameServer::closeTopic(const QString &topic)
+{
+    const QList<Player*> subscribers = m_topics.take(topic);
+    for (Player* pl : subscribers) pl->topics.removeOne(topic);
+}
+
+void GameServer::seatPlayer(Player* pl, Room* room)
+{
+    // 对局中不显示大厅, 房间列表的变化不再发给该玩家; 回到大厅时客户端重新订阅
+    unsubscribe(pl, kLobbyTopic);
+    subscribe(pl, roomTopic(room->id));
+}
+
+void GameServer::handleDelta(Player* pl, Room* room, const QJsonObject &obj)
+{
+    const quint32 seq = quint32(obj.value("seq").toDouble());
+    QJsonObject ack{{"type","move_ack"},{"seq", double(seq)}};
+    QString err;
+    bool ok = false;
+    if (seq != room->seq + 1) {
+        err = QStringLiteral("手数不连续");
+    } else {
+        ok = playOnRoomBoard(pl, room, obj.value("x").toInt(-1), obj.value("y").toInt(-1), &err);
     }
+    if (!ok) {
+        // 不转发; 落子方收到后回滚这一手
+        ack["accepted"] = false;
+        ack["msg"] = err;
+        ack["expected"] = double(room->seq + 1);
+        sendToPlayer(pl, ack);
+        return;
+    }
+    room->seq = seq;
+
+    // 下一手、提子与哈希一律取自服务端盘面
+    const Goban &b = room->board;
+    QJsonArray captures;
+    for (const auto &pt : b.lastCaptures()) {
+        captures.append(pt.first);
+        captures.append(pt.second);
+    }
+    const QString hash = QString::number(b.hash(), 16);
+    QJsonObject out = obj;
+    out["next"] = b.currentPlayer();
+    out["hash"] = hash;
+    out["captures"] = captures;
+    sendToSpectators(room, out);
+    sendToOpponent(pl, out);
+
+    ack["accepted"] = true;
+    ack["hash"] = hash;
+    sendToPlayer(pl, ack);
+}
+
+bool GameServer::playOnRoomBoard(Player* pl, Room* room, int x, int y, QString *err)
+{
+    if (!room->playing) {
+        *err = QStringLiteral("对局未在进行");
+        return false;
+    }
+    const int color = (room->p1 == pl) ? 1 : 2;
+    if (color != room->board.currentPlayer()) {
+        *err = QStringLiteral("未轮到你落子");
+        return false;
+    }
+    if (x < 0 || y < 0) {
+        room->board.pass();
+        return true;
+    }
+    return room->board.play(x, y, err);
+}
+
+void GameServer::finishByScore(Room* room)
+{
+    const QPair<int,int> score = room->board.computeChineseScore();
+    const double black = score.first;
+    const double white = score.second + kKomi;
+    const bool blackWins = black > white;
+
+    QJsonObject out{{"type","end_confirm"},
+                    {"black_score", black}, {"white_score", white}, {"komi", kKomi},
+                    {"winner", blackWins ? "black" : "white"}};
+    EncodedMessage msg;
+    msg.obj = out;
+    publish(roomTopic(room->id), msg);
+    sendToSpectators(room, out);
+
+    // 战绩只依据服务端的点目结果
+    Player* winner = blackWins ? room->p1 : room->p2;
+    Player* loser = blackWins ? room->p2 : room->p1;
+    if (winner && winner->userId != 0) recordResult(winner->userId, true);
+    if (loser && loser->userId != 0) recordResult(loser->userId, false);
+    qDebug() << "房间点目结束:" << room->id << "黑" << black << "白" << white;
+
+    room->playing = false;
+    room->endRequestedBy = nullptr;
+    room->p1Ready = false;
+    room->p2Ready = false;
+    broadcastRoomList();
+}
+
+void GameServer::sendSnapshot(Room* room, Player* to)
+{
+    if (!room || !to) return;
+    QJsonObject sync{{"type","sync"},
+                     {"seq", double(room->seq)},
+                     {"currentPlayer", room->board.currentPlayer()},
+                     {"packed", QString::fromLatin1(room->board.packBoard().toBase64())}};
+    if (to != room->p1 && to != room->p2) sync["room_id"] = room->id;
+    sendToPlayer(to, sync);
+}
+
+void GameServer::closeRoomTopics(Room* room)
+{
+    if (!room) return;
+    sendToSpectators(room, QJsonObject{{"type","room_closed"}});
+    closeTopic(spectateTopic(room->id));
+    closeTopic(roomTopic(room->id));
 }
 
 void GameServer::sendRoomListToPlayer(Player* pl)
 {
-    QJsonArray arr;
-    for (auto it = m_rooms.begin(); it != m_rooms.end(); ++it) {
-        Room* r = it.value();
-        QJsonObject jo;
-        jo["room_id"] = r->id;
-        int cnt = 0;
-        if (r->p1) ++cnt;
-        if (r->p2) ++cnt;
-        jo["players"] = cnt;
-        jo["status"] = (r->p1 && r->p2) ? QString("游戏中") : QString("等待中");
-        // 包含玩家摘要信息
-        if (r->p1) {
-            QJsonObject p1; p1["nickname"] = r->p1->nickname; p1["username"]=r->p1->username; p1["rating"]=r->p1->rating;
-            jo["p1"] = p1;
-        }
-        if (r->p2) {
-            QJsonObject p2; p2["nickname"] = r->p2->nickname; p2["username"]=r->p2->username; p2["rating"]=r->p2->rating;
-            jo["p2"] = p2;
-        }
-        arr.append(jo);
+    // 先发布尚未发出的变化, 保证快照内容与版本号对应
+    broadcastRoomList();
+    if (m_roomSnapshot.obj.isEmpty() || m_roomSnapshotVersion != m_roomListVersion) {
+        QJsonArray arr;
+        for (const QJsonObject &jo : qAsConst(m_roomSummaries)) arr.append(jo);
+        m_roomSnapshot = EncodedMessage();
+        m_roomSnapshot.obj = QJsonObject{{"type","room_list"},{"version", double(m_roomListVersion)},{"rooms", arr}};
+        m_roomSnapshotVersion = m_roomListVersion;
+    }
+    // 未登录的连接只收一次快照, 不订阅大厅增量
+    if (pl->userId != 0) subscribe(pl, kLobbyTopic);
+    sendEncoded(pl, m_roomSnapshot);
+}
+
+QJsonObject GameServer::roomSummary(Room* r) const
+{
+    QJsonObject jo;
+    jo["room_id"] = r->id;
+    int cnt = 0;
+    if (r->p1) ++cnt;
+    if (r->p2) ++cnt;
+    jo["players"] = cnt;
+    jo["status"] = (r->p1 && r->p2) ? QString("游戏中") : QString("等待中");
+    // 包含玩家摘要信息
+    if (r->p1) {
+        QJsonObject p1; p1["nickname"] = r->p1->nickname; p1["username"]=r->p1->username; p1["rating"]=r->p1->rating;
+        jo["p1"] = p1;
     }
-    QJsonObject out; out["type"]="room_list"; out["rooms"]=arr;
-    sendToPlayer(pl, out);
+    if (r->p2) {
+        QJsonObject p2; p2["nickname"] = r->p2->nickname; p2["username"]=r->p2->username; p2["rating"]=r->p2->rating;
+        jo["p2"] = p2;
+    }
+    return jo;
 }
 
 Room* GameServer::getRoomForPlayer(Player* pl)
@@ -574,22 +1053,144 @@ Room* GameServer::getRoomForPlayer(Player* pl)
 
 void GameServer::broadcastRoomList()
 {
-    for (auto it = m_map.begin(); it != m_map.end(); ++it) {
-        Player* pl = it.value();
-        if (pl) sendRoomListToPlayer(pl);
+    QMap<QString, QJsonObject> current;
+    QJsonArray added, updated, removed;
+    for (auto it = m_rooms.begin(); it != m_rooms.end(); ++it) {
+        const QJsonObject jo = roomSummary(it.value());
+        current.insert(it.key(), jo);
+        auto old = m_roomSummaries.constFind(it.key());
+        if (old == m_roomSummaries.constEnd()) added.append(jo);
+        else if (old.value() != jo) updated.append(jo);
     }
+    for (auto it = m_roomSummaries.constBegin(); it != m_roomSummaries.constEnd(); ++it) {
+        if (!current.contains(it.key())) removed.append(it.key());
+    }
+    if (added.isEmpty() && updated.isEmpty() && removed.isEmpty()) return;
+    m_roomSummaries = current;
+    ++m_roomListVersion;
+
+    // 客户端发现版本不连续时会重新请求快照
+    EncodedMessage msg;
+    msg.obj = QJsonObject{{"type","room_list_delta"},{"version", double(m_roomListVersion)}};
+    if (!added.isEmpty()) msg.obj["added"] = added;
+    if (!updated.isEmpty()) msg.obj["updated"] = updated;
+    if (!removed.isEmpty()) msg.obj["removed"] = removed;
+    publish(kLobbyTopic, msg);
 }
 
-void GameServer::onSocketDisconnected()
+void GameServer::onConnectionClosed(quint64 conn)
 {
-    QWebSocket* sock = qobject_cast<QWebSocket*>(sender());
-    if (!sock || !m_map.contains(sock)) return;
-    Player* pl = m_map[sock];
+    Player* pl = m_map.take(conn);
+    if (!pl) return;
 
     qDebug() << "玩家断开连接:" << pl->id;
 
+    if (!pl->resumeToken.isEmpty()) {
+        suspendPlayer(pl);
+        return;
+    }
+    removePlayer(pl);
+}
+
+void GameServer::suspendPlayer(Player* pl)
+{
+    pl->conn = 0;
+    pl->shard = nullptr;
+    pl->graceTimer = new QTimer(this);
+    pl->graceTimer->setSingleShot(true);
+    connect(pl->graceTimer, &QTimer::timeout, this, [this, pl]() {
+        qDebug() << "重连超时, 清理会话:" << pl->id;
+        removePlayer(pl);
+    });
+    pl->graceTimer->start(kResumeGraceMs);
+    // 断线的玩家不能留在匹配队列里, 否则会被配进对局而对手只能干等;
+    // 取消通知进入补发队列, 重连后客户端据此退出 "匹配中" 状态
+    if (m_waiting.removeAll(pl) > 0) {
+        sendToPlayer(pl, QJsonObject{{"type","match_cancelled"}, {"msg","连接已断开, 匹配已取消"}});
+    }
+    // 断线期间不积压大厅增量, 重连后重新发快照
+    unsubscribe(pl, kLobbyTopic);
+    sendToOpponent(pl, QJsonObject{{"type","opponent_disconnected"},{"grace", kResumeGraceMs / 1000}});
+    qDebug() << "保留会话等待重连:" << pl->id;
+}
+
+void GameServer::handleResume(Player* pl, const QJsonObject &obj)
+{
+    Player* old = m_sessions.value(obj.value("token").toString(), nullptr);
+    quint64 received = quint64(obj.value("received").toDouble());
+    // 只有尚未登录、订阅、排队或入座的新连接才能接管会话 (接管后其 Player 直接释放)
+    const bool fresh = pl->userId == 0 && pl->resumeToken.isEmpty() && pl->topics.isEmpty()
+                       && pl->roomId.isEmpty() && !m_waiting.contains(pl);
+    if (!fresh) {
+        sendControl(pl, QJsonObject{{"type","resume_result"},{"success",false},{"msg","该连接已在使用中, 无法恢复会话"}});
+        return;
+    }
+    // 客户端缺失的消息必须仍在补发队列中, 否则只能重新登录
+    if (!old || old == pl || received < old->outboxBase || received > old->sentCount) {
+        sendControl(pl, QJsonObject{{"type","resume_result"},{"success",false},{"msg","会话已失效"}});
+        return;
+    }
+
+    // 旧连接可能还没被发现已断开 (半开连接), 直接丢弃
+    if (old->conn) {
+        m_map.remove(old->conn);
+        closeConnection(old);
+    }
+    if (old->graceTimer) {
+        old->graceTimer->deleteLater();
+        old->graceTimer = nullptr;
+    }
+
+    // 新连接接管原会话, 沿用新连接上协商的编码
+    old->conn = pl->conn;
+    old->shard = pl->shard;
+    old->codec = pl->codec;
+    m_map[old->conn] = old;
+    delete pl;
+
+    acknowledge(old, received);
+    old->recvAcked = old->recvCount;
+    sendControl(old, QJsonObject{{"type","resume_result"},{"success",true},{"received", double(old->recvCount)}});
+    for (const QJsonObject &m : qAsConst(old->outbox)) sendControl(old, m);
+    qDebug() << "会话已恢复:" << old->id << "补发" << old->outbox.size() << "条";
+
+    sendToOpponent(old, QJsonObject{{"type","opponent_reconnected"}});
+    // 断线期间没有订阅大厅, 仍在大厅的玩家补发一份最新的房间列表
+    if (old->roomId.isEmpty()) sendRoomListToPlayer(old);
+}
+
+void GameServer::handlePing(Player* pl, const QJsonObject &obj)
+{
+    const int rtt = obj.value("rtt").toInt(-1);
+    if (rtt >= 1000 && pl->rttMs < 1000) {
+        qDebug() << "玩家网络延迟过高:" << pl->id << pl->username << "rtt" << rtt << "ms jitter" << obj.value("jitter").toInt() << "ms";
+    }
+    pl->rttMs = rtt;
+    pl->jitterMs = obj.value("jitter").toInt();
+    pl->queuedBytes = qint64(obj.value("queue").toDouble());
+
+    QJsonObject pong{{"type","pong"},{"t", obj.value("t")}};
+    Room* room = getRoomForPlayer(pl);
+    Player* other = room ? (room->p1 == pl ? room->p2 : room->p1) : nullptr;
+    if (other && other->rttMs >= 0) pong["peer_rtt"] = other->rttMs;
+    sendControl(pl, pong);
+}
+
+void GameServer::acknowledge(Player* pl, quint64 received)
+{
+    while (!pl->outbox.isEmpty() && pl->outboxBase < received) {
+        pl->outbox.removeFirst();
+        ++pl->outboxBase;
+    }
+}
+
+void GameServer::removePlayer(Player* pl)
+{
     // 如果在等待队列中, 则移除
     m_waiting.removeAll(pl);
+    const QStringList topics = pl->topics;
+    for (const QString &t : topics) unsubscribe(pl, t);
+    m_sessions.remove(pl->resumeToken);
 
     // 如果在房间中, 通知对手并清理房间
     QString rid = pl->roomId;
@@ -600,12 +1201,12 @@ void GameServer::onSocketDisconnected()
             sendToPlayer(other, QJsonObject{{"type","opponent_left"},{"room_id", rid}});
             other->roomId.clear();
         }
+        closeRoomTopics(r);
         m_rooms.remove(rid);
         delete r;
         broadcastRoomList();
     }
 
-    m_map.remove(sock);
-    sock->deleteLater();
+    if (pl->graceTimer) pl->graceTimer->deleteLater();
     delete pl;
 }
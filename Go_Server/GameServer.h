@@ -2,12 +2,22 @@
 #define GAMESERVER_H
 
 #include <QObject>
-#include <QWebSocketServer>
-#include <QWebSocket>
 #include <QMap>
+#include <QHash>
 #include <QQueue>
+#include <QStringList>
+#include <QJsonObject>
+#include <atomic>
+#include <functional>
 
 #include "authmanager.h"
+#include "connectionshard.h"
+#include "mpscqueue.h"
+#include "wirecodec.h"
+#include "goban.h"
+
+class QTimer;
+class QThread;
 
 // 玩家数据结构
 struct Player {
@@ -19,10 +29,27 @@ struct Player {
     int wins = 0;       // 胜场
     int losses = 0;     // 负场
 
-    QWebSocket* socket = nullptr; // WebSocket 连接指针
+    quint64 conn = 0;   // 连接编号, 0 表示未连接
+    ConnectionShard* shard = nullptr; // 连接所在的分片线程
     QString roomId;     // 所在房间ID
     bool isBlack = false; // 是否执黑
     bool ready = false;   // 是否已准备
+    QStringList topics; // 已订阅的主题 (见 GameServer::subscribe)
+    WireCodec::Format codec = WireCodec::Json; // 与该客户端协商的发送编码
+
+    // 会话恢复: 双方各自按顺序计数业务消息 (控制消息除外), 断线重连时凭序号补发缺失部分
+    QString resumeToken;          // 登录成功后签发, 断线宽限期内凭此接管原会话
+    quint64 sentCount = 0;        // 已发给该玩家的消息数 (含断线期间未送达的)
+    quint64 outboxBase = 0;       // outbox 首条消息的序号
+    QList<QJsonObject> outbox;    // 客户端尚未确认收到的消息
+    quint64 recvCount = 0;        // 已收到该玩家的消息数
+    quint64 recvAcked = 0;        // 上次回执时的 recvCount
+    QTimer* graceTimer = nullptr; // 非空表示连接已断开, 会话保留中
+
+    // 客户端随 ping 上报的网络质量, -1 表示尚未上报
+    int rttMs = -1;
+    int jitterMs = 0;
+    qint64 queuedBytes = 0;
 };
 
 // 房间数据结构
@@ -32,8 +59,40 @@ struct Room {
     Player* p2 = nullptr; // 玩家2
     bool p1Ready = false; // 玩家1是否准备
     bool p2Ready = false; // 玩家2是否准备
+
+    // 权威对局状态: 落子由服务端按规则校验后才转发, 终局由服务端点目
+    Goban board;                    // p1 执黑, p2 执白
+    quint32 seq = 0;                // 已确认的手数 (含虚着)
+    bool playing = false;           // 对局进行中 (start 之后, 认输/点目之前)
+    Player* endRequestedBy = nullptr; // 发起点目请求的一方, 等待对方确认
 };
 
+// 发给多个玩家的消息: 每种编码最多编码一次, 各连接共享同一份字节 (QByteArray 隐式共享, 只增加引用计数)
+// 收到的消息以原始字节预先填入对应编码, 原样转发时不再重新编码
+struct EncodedMessage {
+    QJsonObject obj;
+    QByteArray json;
+    QByteArray cbor;
+
+    const QByteArray &frame(WireCodec::Format format)
+    {
+        QByteArray &f = (format == WireCodec::Cbor ? cbor : json);
+        if (f.isEmpty()) f = WireCodec::encode(obj, format);
+        return f;
+    }
+};
+
+/*
+ GameServer: 大厅、匹配与房间逻辑
+  - 连接分散在若干分片线程 (ConnectionShard) 中收发与编解码, 主线程只处理已解码的消息,
+    因此房间与玩家状态不需要加锁
+  - 数据库访问在单独的线程执行, 结果回到主线程继续处理, 慢查询不会卡住其他玩家
+  - 群发消息按主题投递, 只发给订阅者:
+    * lobby: 房间列表增量; 已登录玩家在登录、list_rooms 或 subscribe 时订阅, 入座或断线时退订
+      (未登录的 list_rooms 只返回快照)
+    * room:<id>: 房间内的两名玩家, 入座时订阅, 房间关闭时清除
+    * spectate:<id>: 该房间的观战者 (spectate/unspectate)
+*/
 class GameServer : public QObject
 {
     Q_OBJECT
@@ -45,33 +104,59 @@ public:
     bool initAuthDB(const QString &dbHost, int dbPort,
                     const QString &dbName, const QString &dbUser,
                     const QString &dbPassword, QString &errMsg);
-    // 启动服务器
-    bool startServer(quint16 port);
+    // 启动服务器; workers 为连接分片线程数, 0 表示按 CPU 核数
+    bool startServer(quint16 port, int workers = 0);
     // 停止服务器
     void stopServer();
+    // 线程安全: 分片线程上报连接事件
+    void postEvent(ShardEvent ev);
 
 private slots:
-    // 处理新连接
-    void onNewConnection();
-    // 处理收到的文本消息
-    void onTextMessageReceived(const QString &message);
-    // 处理连接断开
-    void onSocketDisconnected();
+    // 把新接入的连接交给下一个分片
+    void onIncomingDescriptor(qintptr fd);
+    // 处理分片上报的所有待处理事件
+    void drainInbound();
 
 private:
+    // 处理一条分片事件
+    void handleShardEvent(const ShardEvent &ev);
+    // 处理连接断开
+    void onConnectionClosed(quint64 conn);
+    // 计数并回执一条消息, 解码成功时交给 handleMessage
+    void dispatchMessage(Player* pl, const ShardEvent &ev);
+    // 处理已解码的消息 (in 附带收到的原始字节)
+    void handleMessage(Player* pl, EncodedMessage &in);
     // 处理匹配请求
     void handleMatch(Player* pl);
     // 当双方准备好时尝试开始游戏
     void tryStartWhenReady(Room* room);
-    // 向指定玩家发送消息
+    // 向指定玩家发送消息 (计入会话序号; 断线期间只进入补发队列)
     void sendToPlayer(Player* pl, const QJsonObject &obj);
+    // 同 sendToPlayer, 但使用预先编码好的字节 (群发时共享)
+    void sendEncoded(Player* pl, EncodedMessage &msg);
+    // 计入会话序号并放入补发队列
+    void trackOutgoing(Player* pl, const QJsonObject &obj);
+    // 直接写入当前连接, 不计数也不缓存 (控制消息与补发)
+    void sendControl(Player* pl, const QJsonObject &obj);
+    // 断开玩家当前的连接 (不上报 Closed)
+    void closeConnection(Player* pl);
+    // 在数据库线程执行 job, 完成后在主线程以其结果调用 done (可为空)
+    void runOnDb(std::function<QJsonObject(AuthManager*)> job,
+                 std::function<void(const QJsonObject&)> done);
+    // 登录查询完成后继续处理: 防多开检查、填充玩家信息并签发恢复令牌
+    void completeLogin(Player* pl, const QString &username, const QJsonObject &ret);
+    // 异步记录一局的胜负
+    void recordResult(int userId, bool win);
     // 向指定玩家的对手发送消息
     void sendToOpponent(Player* pl, const QJsonObject &obj);
-    // 向指定玩家发送房间列表
+    void sendToOpponent(Player* pl, EncodedMessage &msg);
+    // 向指定玩家发送带版本号的房间列表快照; 已登录玩家之后接收增量
     void sendRoomListToPlayer(Player* pl);
+    // 房间在列表中的摘要
+    QJsonObject roomSummary(Room* r) const;
     // 获取玩家所在的房间
     Room* getRoomForPlayer(Player* pl);
-    // 广播房间列表给所有玩家
+    // 与上次发布的房间列表比较, 把新增/变化/删除的房间作为一条增量发给所有大厅玩家
     void broadcastRoomList();
     // 为两个玩家创建房间
     QString createRoomForTwo(Player* a, Player* b);
@@ -79,19 +164,69 @@ private:
     void handleCreateRoom(Player* pl);
     // 处理加入房间请求 (手动)
     void handleJoinRoom(Player* pl, const QString &roomId);
+    // 将对局消息转发给房间的观战者 (附带 room_id)
+    void sendToSpectators(Room* room, QJsonObject obj);
+    // 订阅/退订主题; 重复订阅无副作用
+    void subscribe(Player* pl, const QString &topic);
+    void unsubscribe(Player* pl, const QString &topic);
+    // 向主题的所有订阅者发送同一条消息
+    void publish(const QString &topic, EncodedMessage &msg);
+    // 清除主题的所有订阅
+    void closeTopic(const QString &topic);
+    // 玩家入座: 订阅房间主题, 不再接收大厅消息
+    void seatPlayer(Player* pl, Room* room);
+    // 在服务端盘面上校验并执行增量落子, 转发后回复落子方 move_ack
+    void handleDelta(Player* pl, Room* room, const QJsonObject &obj);
+    // 在服务端盘面上执行一手 (x/y 为负表示虚着); 不合法时写入 err
+    bool playOnRoomBoard(Player* pl, Room* room, int x, int y, QString *err);
+    // 双方同意终局: 服务端按中国规则点目, 通知双方与观战者并记录战绩
+    void finishByScore(Room* room);
+    // 向玩家或观战者发送服务端盘面的全量快照 (观战者附带 room_id)
+    void sendSnapshot(Room* room, Player* to);
+    // 房间关闭前通知观战者, 并清除该房间的玩家与观战主题
+    void closeRoomTopics(Room* room);
+    // 处理重连请求: 把新连接绑定到 token 对应的原会话并补发缺失的消息
+    void handleResume(Player* pl, const QJsonObject &obj);
+    // 记录客户端上报的网络质量并回复 pong (附带对手的往返时延)
+    void handlePing(Player* pl, const QJsonObject &obj);
+    // 客户端确认已收到前 received 条消息, 释放补发队列
+    void acknowledge(Player* pl, quint64 received);
+    // 已登录玩家断线: 保留座位与房间, 宽限期后仍未重连再清理
+    void suspendPlayer(Player* pl);
+    // 彻底移除玩家: 退出匹配与观战, 关闭所在房间并释放
+    void removePlayer(Player* pl);
 
 private:
-    QWebSocketServer* m_server = nullptr;
-    // WebSocket 到 Player 对象的映射
-    QMap<QWebSocket*, Player*> m_map;
+    ShardListener* m_listener = nullptr;
+    QList<QThread*> m_shardThreads;
+    QList<ConnectionShard*> m_shards;
+    int m_nextShard = 0;
+    // 分片上报的事件, 由主线程 drainInbound 取出
+    MpscQueue<ShardEvent> m_inbound;
+    std::atomic<bool> m_drainScheduled{false};
+
+    // 连接编号到 Player 对象的映射
+    QHash<quint64, Player*> m_map;
+    // 主题到订阅者的映射 (与 Player::topics 互为索引)
+    QHash<QString, QList<Player*>> m_topics;
     // 房间ID 到 Room 对象的映射
     QMap<QString, Room*> m_rooms;
     // 等待匹配的玩家队列
     QQueue<Player*> m_waiting;
+    // 恢复令牌到玩家的映射 (含断线保留中的玩家, 它们不在 m_map 中)
+    QHash<QString, Player*> m_sessions;
     // 房间计数器, 用于生成房间ID
     int m_roomCounter = 0;
 
-    AuthManager m_auth;
+    // 房间列表: 每次发布增量版本号加一, 快照与上次发布的摘要一致
+    quint64 m_roomListVersion = 0;
+    QMap<QString, QJsonObject> m_roomSummaries;
+    EncodedMessage m_roomSnapshot;   // 缓存的快照, 版本变化后重建
+    quint64 m_roomSnapshotVersion = 0;
+
+    // 数据库线程及其中的认证对象 (只在该线程中使用)
+    QThread* m_dbThread = nullptr;
+    AuthManager* m_auth = nullptr;
 };
 
 #endif // GAMESERVER_H
@@ -0,0 +1,128 @@
+#include "connectionshard.h"
+#include "GameServer.h"
+
+#include <QWebSocket>
+#include <QWebSocketServer>
+#include <QTcpSocket>
+#include <QDebug>
+
+namespace {
+// 连接编号从 1 开始, 0 表示 "未连接"
+std::atomic<quint64> g_nextConn{0};
+}
+
+ConnectionShard::ConnectionShard(int index, GameServer* server)
+    : m_index(index), m_server(server)
+{
+}
+
+void ConnectionShard::init()
+{
+    m_upgrader = new QWebSocketServer(QStringLiteral("GoCentralServer"),
+                                      QWebSocketServer::NonSecureMode, this);
+    connect(m_upgrader, &QWebSocketServer::newConnection, this, &ConnectionShard::onNewConnection);
+}
+
+void ConnectionShard::adoptDescriptor(qintptr fd)
+{
+    QTcpSocket* tcp = new QTcpSocket;
+    if (!tcp->setSocketDescriptor(fd)) {
+        qWarning() << "分片" << m_index << "无法接管连接:" << tcp->errorString();
+        delete tcp;
+        return;
+    }
+    // 握手完成后触发 newConnection; 握手器接管 tcp 的所有权
+    m_upgrader->handleConnection(tcp);
+}
+
+void ConnectionShard::onNewConnection()
+{
+    while (m_upgrader->hasPendingConnections()) {
+        QWebSocket* sock = m_upgrader->nextPendingConnection();
+        const quint64 conn = ++g_nextConn;
+        m_sockets.insert(conn, sock);
+
+        connect(sock, &QWebSocket::textMessageReceived, this, [this, conn](const QString &message) {
+            deliverFrame(conn, message.toUtf8(), false);
+        });
+        connect(sock, &QWebSocket::binaryMessageReceived, this, [this, conn](const QByteArray &message) {
+            deliverFrame(conn, message, true);
+        });
+        connect(sock, &QWebSocket::disconnected, this, [this, conn, sock]() {
+            m_sockets.remove(conn);
+            sock->deleteLater();
+            ShardEvent ev;
+            ev.kind = ShardEvent::Closed;
+            ev.conn = conn;
+            ev.shard = this;
+            m_server->postEvent(ev);
+        });
+
+        ShardEvent ev;
+        ev.kind = ShardEvent::Opened;
+        ev.conn = conn;
+        ev.shard = this;
+        ev.peer = sock->peerAddress().toString();
+        m_server->postEvent(ev);
+    }
+}
+
+void ConnectionShard::deliverFrame(quint64 conn, const QByteArray &data, bool binary)
+{
+    ShardEvent ev;
+    ev.conn = conn;
+    ev.shard = this;
+    ev.binary = binary;
+    ev.kind = WireCodec::decode(data, binary, &ev.obj) ? ShardEvent::Message : ShardEvent::BadFrame;
+    if (ev.kind == ShardEvent::Message) ev.raw = data;
+    m_server->postEvent(ev);
+}
+
+void ConnectionShard::post(ShardCommand cmd)
+{
+    m_commands.push(std::move(cmd));
+    // 入队之后再检查标志: 已有未执行的唤醒时不重复投递
+    if (!m_drainScheduled.exchange(true)) {
+        QMetaObject::invokeMethod(this, &ConnectionShard::drainCommands, Qt::QueuedConnection);
+    }
+}
+
+void ConnectionShard::drainCommands()
+{
+    // 先清标志再取: 此后入队的命令一定会再投递一次唤醒
+    m_drainScheduled.store(false);
+    ShardCommand cmd;
+    while (m_commands.pop(&cmd)) {
+        QWebSocket* sock = m_sockets.value(cmd.conn, nullptr);
+        if (!sock) continue;
+        if (cmd.kind == ShardCommand::Close) {
+            // 主线程已不再跟踪该连接, 不再上报 Closed
+            m_sockets.remove(cmd.conn);
+            disconnect(sock, nullptr, this, nullptr);
+            sock->abort();
+            sock->deleteLater();
+            continue;
+        }
+        const QByteArray frame = cmd.frame.isEmpty() ? WireCodec::encode(cmd.obj, cmd.codec) : cmd.frame;
+        if (cmd.codec == WireCodec::Cbor) {
+            sock->sendBinaryMessage(frame);
+        } else {
+            sock->sendTextMessage(QString::fromUtf8(frame));
+        }
+    }
+}
+
+void ConnectionShard::closeAll()
+{
+    for (QWebSocket* sock : qAsConst(m_sockets)) {
+        disconnect(sock, nullptr, this, nullptr);
+        sock->close();
+        sock->deleteLater();
+    }
+    m_sockets.clear();
+}
+
+void ShardListener::incomingConnection(qintptr fd)
+{
+    emit descriptorReady(fd);
+}
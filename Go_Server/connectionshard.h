@@ -0,0 +1,93 @@
+#ifndef CONNECTIONSHARD_H
+#define CONNECTIONSHARD_H
+
+#include <QObject>
+#include <QTcpServer>
+#include <QHash>
+#include <QJsonObject>
+#include <atomic>
+
+#include "mpscqueue.h"
+#include "wirecodec.h"
+
+class QWebSocket;
+class QWebSocketServer;
+class GameServer;
+class ConnectionShard;
+
+// 分片线程 -> 主线程
+struct ShardEvent {
+    enum Kind { Opened, Message, BadFrame, Closed };
+    Kind kind = Message;
+    quint64 conn = 0;                 // 连接编号, 全局唯一
+    ConnectionShard* shard = nullptr; // 连接所在的分片
+    QJsonObject obj;                  // Message: 已解码的消息
+    bool binary = false;              // Message/BadFrame: 是否为二进制帧
+    QByteArray raw;                   // Message: 收到的原始字节 (文本帧为 UTF-8), 原样转发时免去重新编码
+    QString peer;                     // Opened: 对端地址
+};
+
+// 主线程 -> 分片线程
+struct ShardCommand {
+    enum Kind { Send, Close };
+    Kind kind = Send;
+    quint64 conn = 0;
+    QJsonObject obj;
+    WireCodec::Format codec = WireCodec::Json;
+    QByteArray frame; // 非空时为已按 codec 编码好的消息, 直接发送
+};
+
+/*
+ ConnectionShard: 在独立线程中持有一部分客户端连接
+  - 套接字在本线程创建并只在本线程读写, WebSocket 握手、收发与消息编解码都不占用主线程
+  - 收到的消息解码后经无锁队列交给 GameServer 在主线程处理; 主线程发出的消息同样经无锁队列送回本线程编码发送
+  - 队列非空时才投递一次唤醒, 突发的大量消息合并为一次处理
+*/
+class ConnectionShard : public QObject
+{
+    Q_OBJECT
+public:
+    ConnectionShard(int index, GameServer* server);
+
+    int index() const { return m_index; }
+    // 线程安全: 把发送/关闭请求交给本分片
+    void post(ShardCommand cmd);
+
+public slots:
+    // 在分片线程中创建 WebSocket 握手器 (线程启动后调用一次)
+    void init();
+    // 接管主线程 accept 到的 TCP 连接
+    void adoptDescriptor(qintptr fd);
+    // 关闭本分片的所有连接 (停服时调用)
+    void closeAll();
+
+private slots:
+    void onNewConnection();
+    void drainCommands();
+
+private:
+    void deliverFrame(quint64 conn, const QByteArray &data, bool binary);
+
+    int m_index;
+    GameServer* m_server;
+    QWebSocketServer* m_upgrader = nullptr; // 不监听端口, 仅把 TCP 连接升级为 WebSocket
+    QHash<quint64, QWebSocket*> m_sockets;
+    MpscQueue<ShardCommand> m_commands;
+    std::atomic<bool> m_drainScheduled{false};
+};
+
+// 主线程只负责 accept, 套接字描述符交给分片线程创建连接对象
+class ShardListener : public QTcpServer
+{
+    Q_OBJECT
+public:
+    using QTcpServer::QTcpServer;
+
+signals:
+    void descriptorReady(qintptr fd);
+
+protected:
+    void incomingConnection(qintptr fd) override;
+};
+
+#endif // CONNECTIONSHARD_H
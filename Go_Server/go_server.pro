@@ -3,9 +3,19 @@ CONFIG += c++11 console
 CONFIG -= app_bundle
 TEMPLATE = app
 
+# 与客户端共用的消息编解码与围棋规则
+INCLUDEPATH += ../Go
+
 SOURCES += main.cpp \
            AuthManager.cpp \
-           GameServer.cpp
+           GameServer.cpp \
+           connectionshard.cpp \
+           ../Go/goban.cpp \
+           ../Go/wirecodec.cpp
 
 HEADERS += GameServer.h \
-    AuthManager.h
+    AuthManager.h \
+    connectionshard.h \
+    mpscqueue.h \
+    ../Go/goban.h \
+    ../Go/wirecodec.h
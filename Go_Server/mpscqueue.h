@@ -0,0 +1,58 @@
+#ifndef MPSCQUEUE_H
+#define MPSCQUEUE_H
+
+#include <atomic>
+#include <utility>
+
+/*
+ MpscQueue: 无锁多生产者单消费者队列 (Vyukov 链表队列)
+  - push 可在任意线程调用, 只有一次原子交换, 不加锁
+  - pop 只能由唯一的消费者线程调用; 队列空时返回 false
+  - 生产者交换完队尾但尚未链接时, pop 可能暂时看不到该元素 (也看不到其后的元素);
+    配合 "入队后再检查唤醒标志" 的用法, 该生产者随后发出的唤醒会让消费者再取一次
+*/
+template <typename T>
+class MpscQueue
+{
+public:
+    MpscQueue() : m_head(new Node), m_tail(m_head.load(std::memory_order_relaxed)) {}
+    ~MpscQueue()
+    {
+        T discard;
+        while (pop(&discard)) {}
+        delete m_tail;
+    }
+    MpscQueue(const MpscQueue &) = delete;
+    MpscQueue &operator=(const MpscQueue &) = delete;
+
+    void push(T value)
+    {
+        Node *node = new Node;
+        node->value = std::move(value);
+        Node *prev = m_head.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    bool pop(T *out)
+    {
+        Node *tail = m_tail;
+        Node *next = tail->next.load(std::memory_order_acquire);
+        if (!next) return false;
+        // next 成为新的哨兵节点, 其中的值移出后不再使用
+        *out = std::move(next->value);
+        next->value = T();
+        m_tail = next;
+        delete tail;
+        return true;
+    }
+
+private:
+    struct Node {
+        std::atomic<Node *> next{nullptr};
+        T value;
+    };
+    std::atomic<Node *> m_head; // 生产者在此追加
+    Node *m_tail;               // 消费者独占, 始终指向哨兵节点
+};
+
+#endif // MPSCQUEUE_H